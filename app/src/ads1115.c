@@ -0,0 +1,193 @@
+/*
+ * HiSPEC-TIB ADS1115 conversions over RTIO
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Talks to the converter's registers directly instead of through the
+ * Zephyr ADC driver, which runs every conversion from its own thread and
+ * sleeps there. Here a whole set of conversions is one i2c_chain run:
+ * per conversion, a config write that starts it, a delay for the
+ * conversion time, then a config read (to check it finished) and a
+ * result read. The calling thread still blocks, but once per set.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "ads1115.h"
+#include "i2c_chain.h"
+#include "metrics.h"
+
+LOG_MODULE_REGISTER(ads1115, CONFIG_APP_LOG_LEVEL);
+
+#define REG_CONV    0x00
+#define REG_CONFIG  0x01
+
+#define CFG_OS          BIT(15)     /* write: start; read: 1 when idle */
+#define CFG_MUX_AIN(n)  ((4 + (n)) << 12)
+#define CFG_PGA(n)      ((n) << 9)
+#define CFG_MODE_SINGLE BIT(8)
+#define CFG_DR(n)       ((n) << 5)
+#define CFG_COMP_OFF    0x0003
+
+/* Start, delay, then pointer + read for the config and result registers */
+#define SQES_PER_READ   (2 * I2C_CHAIN_REG_READ_SQES)
+#define SQES_PER_CONV   (2 + SQES_PER_READ)
+
+/* Re-reads of a conversion still running after its delay */
+#define BUSY_RETRIES    2
+
+/* Data rate periods, DR code 0 (8 SPS) to 7 (860 SPS) */
+static const uint32_t dr_period_us[] = {
+    125000, 62500, 31250, 15625, 7813, 4000, 2105, 1163,
+};
+
+I2C_CHAIN_DEFINE(ads_chain, DT_NODELABEL(adc1115), ADS1115_MAX_CONV * SQES_PER_CONV);
+
+/* The chain and its buffers; the boot work probes while the photodiode
+ * thread may already be converting
+ */
+static K_MUTEX_DEFINE(ads_lock);
+static bool ads_found;
+
+static uint8_t rx_config[ADS1115_MAX_CONV][2];
+static uint8_t rx_conv[ADS1115_MAX_CONV][2];
+
+bool ads1115_ready(void)
+{
+    uint8_t config[2];
+    int rc;
+
+    k_mutex_lock(&ads_lock, K_FOREVER);
+    if (!ads_found && i2c_chain_ready(&ads_chain)) {
+        /* A ready bus says nothing about the chip; see that it answers */
+        rc = i2c_chain_reg_read(&ads_chain, REG_CONFIG, config, sizeof(config), false);
+        if (rc == 0) {
+            rc = i2c_chain_run(&ads_chain, I2C_CHAIN_REG_READ_SQES);
+        } else {
+            i2c_chain_cancel(&ads_chain);
+        }
+        ads_found = (rc == 0);
+    }
+    k_mutex_unlock(&ads_lock);
+    return ads_found;
+}
+
+/* Slowest data rate whose period is no longer than asked */
+static uint8_t data_rate(uint32_t period_us)
+{
+    for (uint8_t dr = 0; dr < ARRAY_SIZE(dr_period_us); dr++) {
+        if (dr_period_us[dr] <= period_us) {
+            return dr;
+        }
+    }
+    return ARRAY_SIZE(dr_period_us) - 1;
+}
+
+/* The data rate is only good to 10% */
+static uint32_t conv_delay_us(uint8_t dr)
+{
+    return dr_period_us[dr] + dr_period_us[dr] / 10;
+}
+
+static int queue_conv(const struct ads1115_conv *conv, size_t i, bool last)
+{
+    uint8_t dr = data_rate(conv->period_us);
+    uint16_t config = CFG_OS | CFG_MUX_AIN(conv->ain) | CFG_PGA(conv->pga) |
+                      CFG_MODE_SINGLE | CFG_DR(dr) | CFG_COMP_OFF;
+    uint8_t start[3] = { REG_CONFIG, config >> 8, config & 0xff };
+    int rc;
+
+    rc = i2c_chain_write(&ads_chain, start, sizeof(start), true);
+    if (rc == 0) {
+        rc = i2c_chain_delay(&ads_chain, K_USEC(conv_delay_us(dr)), true);
+    }
+    if (rc == 0) {
+        rc = i2c_chain_reg_read(&ads_chain, REG_CONFIG, rx_config[i], 2, true);
+    }
+    if (rc == 0) {
+        rc = i2c_chain_reg_read(&ads_chain, REG_CONV, rx_conv[i], 2, !last);
+    }
+    return rc;
+}
+
+/* Re-read conversion @p i's config and result registers */
+static int reread(size_t i)
+{
+    int rc = i2c_chain_reg_read(&ads_chain, REG_CONFIG, rx_config[i], 2, true);
+
+    if (rc == 0) {
+        rc = i2c_chain_reg_read(&ads_chain, REG_CONV, rx_conv[i], 2, false);
+    }
+    if (rc != 0) {
+        i2c_chain_cancel(&ads_chain);
+        return rc;
+    }
+    return i2c_chain_run(&ads_chain, SQES_PER_READ);
+}
+
+static int convert(const struct ads1115_conv *conv, size_t n)
+{
+    int rc = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        *conv[i].result = INT16_MIN;
+        if (rc == 0) {
+            rc = queue_conv(&conv[i], i, i == n - 1);
+        }
+    }
+    if (rc != 0) {
+        i2c_chain_cancel(&ads_chain);
+        return rc;
+    }
+
+    uint32_t start = k_cycle_get_32();
+    uint32_t delay_us = 0;
+    uint32_t took_us;
+
+    rc = i2c_chain_run(&ads_chain, n * SQES_PER_CONV);
+    took_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    for (size_t i = 0; i < n; i++) {
+        delay_us += conv_delay_us(data_rate(conv[i].period_us));
+    }
+    /* Time on the bus, and waiting for it, beyond the conversion delays */
+    metrics_i2c_record(METRICS_I2C_ADC, took_us - MIN(delay_us, took_us));
+    if (rc != 0) {
+        LOG_ERR("Conversion failed (%d)", rc);
+        return rc;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t period_us = dr_period_us[data_rate(conv[i].period_us)];
+
+        for (int retry = 0; !(sys_get_be16(rx_config[i]) & CFG_OS); retry++) {
+            if (retry == BUSY_RETRIES) {
+                LOG_ERR("AIN%u conversion did not finish", conv[i].ain);
+                return -ETIMEDOUT;
+            }
+            k_usleep(period_us / 10 + 1);
+            rc = reread(i);
+            if (rc != 0) {
+                LOG_ERR("Conversion failed (%d)", rc);
+                return rc;
+            }
+        }
+        *conv[i].result = (int16_t)sys_get_be16(rx_conv[i]);
+    }
+    return 0;
+}
+
+int ads1115_convert(const struct ads1115_conv *conv, size_t n)
+{
+    int rc;
+
+    if (n == 0 || n > ADS1115_MAX_CONV) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&ads_lock, K_FOREVER);
+    rc = convert(conv, n);
+    k_mutex_unlock(&ads_lock);
+    return rc;
+}
@@ -0,0 +1,41 @@
+/*
+ * HiSPEC-TIB ADS1115 conversions over RTIO
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ADS1115_H
+#define ADS1115_H
+
+#include <zephyr/kernel.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Conversions one ads1115_convert() call can queue */
+#define ADS1115_MAX_CONV 2
+
+/* One single-shot, single-ended conversion */
+struct ads1115_conv {
+    uint8_t ain;            /* input, 0-3, measured against GND */
+    uint8_t pga;            /* 0 = +/-6.144 V, 1 = +/-4.096 V ... 5 = +/-256 mV */
+    uint32_t period_us;     /* slowest data rate whose period fits, 1163 = 860 SPS */
+    int16_t *result;        /* INT16_MIN if the conversion failed */
+};
+
+/**
+ * True once the ADS1115 has answered a read of its config register. The
+ * probe runs until it first succeeds; later calls do not touch the bus.
+ */
+bool ads1115_ready(void);
+
+/**
+ * Run @p n conversions back to back. They are queued as one I2C chain
+ * (start, wait out the conversion, check it finished, read), so the
+ * caller blocks once for the whole set rather than once per conversion.
+ *
+ * @return 0, -EINVAL for more than ADS1115_MAX_CONV, or the first I2C error
+ */
+int ads1115_convert(const struct ads1115_conv *conv, size_t n);
+
+#endif //ADS1115_H
@@ -0,0 +1,142 @@
+/*
+ * HiSPEC-TIB attenuator calibration
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Attenuation is taken relative to the brightest point of the sweep, so
+ * the volt2db curve is 0 dB at minimum loss, matching the hand-fitted
+ * coefficients it replaces. Both directions are fitted independently by
+ * solving the normal equations; at order 4 over a 0-40 dB span they are
+ * still well within double precision.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include "atten_cal.h"
+#include "polyfit.h"
+#include "supervisor.h"
+
+LOG_MODULE_REGISTER(atten_cal, CONFIG_APP_LOG_LEVEL);
+
+/* Fast reads averaged per sweep point */
+#define CAL_AVERAGES 8
+
+BUILD_ASSERT(ATTEN_NUM_COEFFS <= POLYFIT_MAX_COEFFS, "fit order beyond polyfit()");
+
+static int read_average(enum pd_channel ch, double *value)
+{
+    int32_t sum = 0;
+    int16_t sample;
+    int rc;
+
+    for (int i = 0; i < CAL_AVERAGES; i++) {
+        rc = photodiode_read_channel(ch, true, &sample);
+        if (rc != 0) {
+            return rc;
+        }
+        sum += sample;
+    }
+    *value = (double)sum / CAL_AVERAGES;
+    return 0;
+}
+
+static int sweep(struct attenuator *drv, enum pd_channel ch,
+                 const struct atten_cal_params *params, double *power)
+{
+    int rc;
+
+    for (int i = 0; i < params->points; i++) {
+        double v = params->vmin + (params->vmax - params->vmin) * i / (params->points - 1);
+
+        if (!attenuator_set(drv, v, true)) {
+            return -EIO;
+        }
+        k_msleep(params->settle_ms);
+        /* Only the reads hold the ADC; the 50 Hz loop runs while settling */
+        photodiode_adc_lock();
+        rc = read_average(ch, &power[i]);
+        photodiode_adc_unlock();
+        if (rc != 0) {
+            return rc;
+        }
+        supervisor_checkin(SUPERVISOR_EXECUTOR);
+    }
+    return 0;
+}
+
+int atten_calibrate(struct attenuator *drv, enum pd_channel ch,
+                    const struct atten_cal_params *params, struct atten_cal_result *res)
+{
+    double power[ATTEN_CAL_MAX_POINTS];
+    double db2volt[ATTEN_NUM_COEFFS], volt2db[ATTEN_NUM_COEFFS];
+    double start_voltage = drv->voltage;
+    double pmax = 0.0;
+    double sum_db = 0.0, sum_v = 0.0;
+    int rc;
+
+    if (params->points < ATTEN_NUM_COEFFS + 1 || params->points > ATTEN_CAL_MAX_POINTS ||
+        params->vmin < 0.0 || params->vmax > MAX_VOLTAGE || params->vmin >= params->vmax) {
+        return -EINVAL;
+    }
+
+    /* Every point must be read on the same range */
+    photodiode_gain_hold();
+    rc = sweep(drv, ch, params, power);
+    photodiode_gain_release();
+    attenuator_set(drv, start_voltage, true);
+    if (rc != 0) {
+        LOG_ERR("Calibration sweep failed (%d)", rc);
+        return rc;
+    }
+
+    for (int i = 0; i < params->points; i++) {
+        pmax = MAX(pmax, power[i]);
+    }
+
+    /* Points in the dark have no defined attenuation */
+    res->n = 0;
+    for (int i = 0; i < params->points; i++) {
+        if (power[i] <= 0.0) {
+            continue;
+        }
+        res->voltage[res->n] = params->vmin + (params->vmax - params->vmin) * i / (params->points - 1);
+        res->db[res->n] = 10.0 * log10(pmax / power[i]);
+        res->n++;
+    }
+    if (res->n < ATTEN_NUM_COEFFS + 1) {
+        LOG_WRN("Calibration saw light at only %d points", res->n);
+        return -ERANGE;
+    }
+
+    rc = polyfit(res->voltage, res->db, res->n, ATTEN_NUM_COEFFS, volt2db);
+    if (rc == 0) {
+        rc = polyfit(res->db, res->voltage, res->n, ATTEN_NUM_COEFFS, db2volt);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    res->max_db = 0.0;
+    res->max_v = 0.0;
+    for (int i = 0; i < res->n; i++) {
+        double r_db = res->db[i] - attenuator_poly(volt2db, res->voltage[i]);
+        double r_v = res->voltage[i] - attenuator_poly(db2volt, res->db[i]);
+
+        res->res_db[i] = r_db;
+        res->max_db = MAX(res->max_db, fabs(r_db));
+        res->max_v = MAX(res->max_v, fabs(r_v));
+        sum_db += r_db * r_db;
+        sum_v += r_v * r_v;
+    }
+    res->rms_db = sqrt(sum_db / res->n);
+    res->rms_v = sqrt(sum_v / res->n);
+
+    memcpy(drv->coeff_db_to_volt, db2volt, sizeof(db2volt));
+    memcpy(drv->coeff_volt_to_db, volt2db, sizeof(volt2db));
+    LOG_INF("Calibrated over %d points, rms %.3f dB", res->n, res->rms_db);
+    return 0;
+}
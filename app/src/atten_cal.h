@@ -0,0 +1,48 @@
+/*
+ * HiSPEC-TIB attenuator calibration
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ATTEN_CAL_H
+#define ATTEN_CAL_H
+
+#include <zephyr/kernel.h>
+#include <stdint.h>
+
+#include "attenuator.h"
+#include "photodiode.h"
+
+#define ATTEN_CAL_MAX_POINTS 32
+
+struct atten_cal_params {
+    int points;             /* sweep points, order + 2 .. ATTEN_CAL_MAX_POINTS */
+    double vmin;            /* sweep range (V) */
+    double vmax;
+    uint32_t settle_ms;     /* wait after each step before sampling */
+};
+
+struct atten_cal_result {
+    int n;                              /* points used in the fit */
+    double voltage[ATTEN_CAL_MAX_POINTS];
+    double db[ATTEN_CAL_MAX_POINTS];    /* measured, relative to the brightest point */
+    double res_db[ATTEN_CAL_MAX_POINTS];/* measured - fitted volt2db */
+    double rms_db, max_db;              /* volt2db residuals (dB) */
+    double rms_v, max_v;                /* db2volt residuals (V) */
+};
+
+/**
+ * Step @p drv from vmin to vmax, averaging fast photodiode reads of @p ch
+ * at each step, and least-squares fit both calibration curves to
+ * CONFIG_APP_ATTEN_FIT_ORDER. On success the coefficients are installed
+ * in @p drv; either way the attenuator is returned to its starting
+ * voltage. The photodiode range is held for the whole sweep, the ADC only
+ * while each point is read.
+ *
+ * @return 0 on success, -EINVAL for bad parameters, -ERANGE if too few
+ *         points saw light or the fit is singular, or a negative ADC error
+ */
+int atten_calibrate(struct attenuator *drv, enum pd_channel ch,
+                    const struct atten_cal_params *params, struct atten_cal_result *res);
+
+#endif //ATTEN_CAL_H
@@ -7,6 +7,7 @@
 
 #include "attenuator.h"
 #include "devices.h"
+#include "metrics.h"
 LOG_MODULE_REGISTER(attenuator, LOG_LEVEL_INF);
 
 //See
@@ -16,7 +17,6 @@ LOG_MODULE_REGISTER(attenuator, LOG_LEVEL_INF);
 
 #define DAC_RESOLUTION_BITS  12
 #define DAC_MAX_CODE         ((1 << DAC_RESOLUTION_BITS) - 1)
-#define MAX_VOLTAGE          4.096d
 
 // static const struct device *dac_dev = DEVICE_DT_GET(DT_NODELABEL(dac7578));  //or DEVICE_DT_GET_OR_NULL
 
@@ -31,6 +31,14 @@ void attenuator_init(struct attenuator *drv, uint8_t channel) {
 #endif
 }
 
+double attenuator_poly(const double *coeffs, double x) {
+    double y = 0.0;
+    for (int i = ATTEN_NUM_COEFFS - 1; i >= 0; i--) {
+        y = y * x + coeffs[i];
+    }
+    return y;
+}
+
 bool attenuator_set(struct attenuator *drv, double value, bool raw) {
     /* Clamp voltage to [0, MAX_VOLTAGE] */
     double voltage;
@@ -38,9 +46,7 @@ bool attenuator_set(struct attenuator *drv, double value, bool raw) {
         voltage = value;
     }
     else {
-        voltage = drv->coeff_db_to_volt[0]+
-            drv->coeff_db_to_volt[2]*value*value+
-                drv->coeff_db_to_volt[1]*value;
+        voltage = attenuator_poly(drv->coeff_db_to_volt, value);
     }
 
     if (voltage < 0.0d) {
@@ -62,7 +68,10 @@ bool attenuator_set(struct attenuator *drv, double value, bool raw) {
     }
 
     uint32_t code = (uint32_t)((drv->voltage / MAX_VOLTAGE) * DAC_MAX_CODE);
+    uint32_t start = k_cycle_get_32();
+
     err = dac_write_value(dac_dev, drv->cfg.channel_id, code);
+    metrics_i2c_record(METRICS_I2C_DAC, k_cyc_to_us_floor32(k_cycle_get_32() - start));
     if (err != 0) {
         LOG_ERR("DAC write failed: %d", err);
         return false;
@@ -75,9 +84,7 @@ bool attenuator_get(struct attenuator *drv, double *value, bool raw) {
     if (raw) {
         *value = drv->voltage;
     } else {
-        *value = drv->coeff_volt_to_db[0]+
-            drv->voltage*drv->voltage*drv->coeff_volt_to_db[2]+
-                drv->voltage*drv->coeff_volt_to_db[1];
+        *value = attenuator_poly(drv->coeff_volt_to_db, drv->voltage);
     }
 
     return true;
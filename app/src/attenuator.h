@@ -11,12 +11,17 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define MAX_VOLTAGE          4.096d
+
+/* Polynomial coefficients per curve, constant term first */
+#define ATTEN_NUM_COEFFS (CONFIG_APP_ATTEN_FIT_ORDER + 1)
+
 /**
  * Attenuator driver structure.
  */
 struct attenuator {
-    double  coeff_db_to_volt[3];
-    double  coeff_volt_to_db[3];
+    double  coeff_db_to_volt[ATTEN_NUM_COEFFS];
+    double  coeff_volt_to_db[ATTEN_NUM_COEFFS];
     double  voltage;
     struct dac_channel_cfg cfg;
 };
@@ -44,4 +49,11 @@ bool attenuator_set(struct attenuator *drv, double voltage, bool raw);
  */
 bool attenuator_get(struct attenuator *drv, double *voltage, bool raw);
 
+/**
+ * Evaluate a calibration polynomial.
+ * @param coeffs  ATTEN_NUM_COEFFS coefficients, constant term first
+ * @param x       dB or voltage
+ */
+double attenuator_poly(const double *coeffs, double x);
+
 #endif /* ATTENUATOR_H */
\ No newline at end of file
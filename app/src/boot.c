@@ -0,0 +1,137 @@
+/*
+ * HiSPEC-TIB boot stages
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Stage completion is a k_event bit, so anything can wait on any set of
+ * stages. The device and restore stages run on the system work queue;
+ * being FIFO, it runs the restore after the devices it drives are set up.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <stdio.h>
+
+#include <coo_commons/network.h>
+
+#include "boot.h"
+#include "devices.h"
+#include "epoch.h"
+#include "persist.h"
+
+LOG_MODULE_REGISTER(boot, CONFIG_APP_LOG_LEVEL);
+
+static const char *const stage_names[BOOT_STAGE_COUNT] = {
+    [BOOT_DEVICES]  = "devices",
+    [BOOT_SETTINGS] = "settings",
+    [BOOT_RESTORE]  = "restore",
+    [BOOT_NETWORK]  = "network",
+    [BOOT_MQTT]     = "mqtt",
+};
+
+static K_EVENT_DEFINE(boot_events);
+static int32_t stage_ms[BOOT_STAGE_COUNT];
+
+static struct k_work devices_work;
+static struct k_work restore_work;
+static struct coo_network_listener net_listener;
+
+void boot_stage_done(enum boot_stage stage)
+{
+    if (boot_ready(BIT(stage))) {
+        return;
+    }
+
+    /* Written before the event is posted, read only after it is seen */
+    stage_ms[stage] = k_uptime_get_32();
+    k_event_post(&boot_events, BIT(stage));
+    LOG_INF("Boot stage %s ready at %d ms", stage_names[stage], stage_ms[stage]);
+}
+
+bool boot_ready(uint32_t mask)
+{
+    return k_event_test(&boot_events, mask) == mask;
+}
+
+int boot_wait(uint32_t mask, k_timeout_t timeout)
+{
+    return k_event_wait_all(&boot_events, mask, false, timeout) != 0 ? 0 : -EAGAIN;
+}
+
+static void devices_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    devices_ready();
+    setup_mems_switches_and_routes();
+    setup_attenuators();
+    boot_stage_done(BOOT_DEVICES);
+}
+
+static void restore_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    persist_restore();
+    epoch_bump();
+    boot_stage_done(BOOT_RESTORE);
+}
+
+static void on_network_event(bool connected)
+{
+    if (connected) {
+        boot_stage_done(BOOT_NETWORK);
+    }
+}
+
+void boot_start(void)
+{
+    k_work_init(&devices_work, devices_handler);
+    k_work_init(&restore_work, restore_handler);
+    k_work_submit(&devices_work);
+
+    net_listener.cb = on_network_event;
+    coo_network_add_listener(&net_listener);
+}
+
+void boot_settings(void)
+{
+    int rc = settings_subsys_init();
+
+    if (rc) {
+        LOG_ERR("Settings init failed (%d)", rc);
+    } else {
+        settings_load();
+    }
+    boot_stage_done(BOOT_SETTINGS);
+
+    k_work_submit(&restore_work);
+}
+
+int boot_format(char *buf, size_t len)
+{
+    size_t offset;
+    int written;
+
+    written = snprintf(buf, len, "{\"boot\":{");
+    if (written < 0 || written >= (int)len) {
+        return -ENOMEM;
+    }
+    offset = written;
+
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        written = snprintf(buf + offset, len - offset, "%s\"%s\":%d", i > 0 ? "," : "",
+                           stage_names[i], boot_ready(BIT(i)) ? stage_ms[i] : -1);
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+
+    written = snprintf(buf + offset, len - offset, "}}");
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    return offset + written;
+}
@@ -0,0 +1,71 @@
+/*
+ * HiSPEC-TIB boot stages
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <zephyr/kernel.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Start-up runs as concurrent stages instead of one sequence:
+ *
+ *   devices  - power GPIO, Modbus, MEMS switches, attenuators (system work queue)
+ *   settings - settings_load() into the persist shadow (main thread)
+ *   restore  - saved attenuator/MEMS state applied; after devices and settings
+ *   network  - first L4 connectivity (DHCP or static), from conn_mgr events
+ *   mqtt     - first broker session subscribed; commands can arrive
+ *
+ * Commands check the stages they depend on and answer "not ready" until
+ * then, so the board takes commands as soon as MQTT is up.
+ */
+enum boot_stage {
+    BOOT_DEVICES,
+    BOOT_SETTINGS,
+    BOOT_RESTORE,
+    BOOT_NETWORK,
+    BOOT_MQTT,
+    BOOT_STAGE_COUNT
+};
+
+/* Stages a command touching the hardware depends on */
+#define BOOT_HARDWARE (BIT(BOOT_DEVICES) | BIT(BOOT_RESTORE))
+
+/**
+ * Start the device stage on the system work queue and begin watching for
+ * the network stage. Call first thing in main(), before coo_network_init().
+ */
+void boot_start(void);
+
+/**
+ * Run the settings stage on the calling thread, then queue the restore
+ * stage behind the device stage.
+ */
+void boot_settings(void);
+
+/** Mark @p stage complete and record its uptime */
+void boot_stage_done(enum boot_stage stage);
+
+/** True once every stage in @p mask (BIT(stage) values) is complete */
+bool boot_ready(uint32_t mask);
+
+/**
+ * Wait until every stage in @p mask is complete.
+ *
+ * @return 0 when ready, -EAGAIN on timeout
+ */
+int boot_wait(uint32_t mask, k_timeout_t timeout);
+
+/**
+ * Format stage completion times, in ms since power-up, as JSON:
+ * {"boot":{"devices":12,...}}, with -1 for stages still pending.
+ *
+ * @return Number of bytes written (excluding NUL), or negative on overflow
+ */
+int boot_format(char *buf, size_t len);
+
+#endif //BOOT_H
@@ -0,0 +1,125 @@
+/*
+ * HiSPEC-TIB photodiode transient capture
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * A dedicated thread owns the ADC for the length of a capture. The caller
+ * blocks only for the pre-trigger window; the thread marks the trigger
+ * when it releases the caller, so the actuation that follows falls right
+ * after the trigger sample.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+#include "capture.h"
+#include "outbound.h"
+
+LOG_MODULE_REGISTER(capture, CONFIG_APP_LOG_LEVEL);
+
+#define CAPTURE_STACK_SIZE 1024
+/* Above the 50 Hz loop, which it preempts for the length of a capture */
+#define CAPTURE_PRIORITY   3
+
+BUILD_ASSERT(sizeof(struct capture_header) + CONFIG_APP_CAPTURE_SAMPLES * sizeof(int16_t)
+             <= MAX_PAYLOAD_LEN, "capture does not fit in one publish");
+BUILD_ASSERT(CONFIG_APP_CAPTURE_PRE_SAMPLES < CONFIG_APP_CAPTURE_SAMPLES);
+
+static K_SEM_DEFINE(start_sem, 0, 1);
+static K_SEM_DEFINE(trigger_sem, 0, 1);
+static atomic_t busy;
+
+static enum pd_channel capture_ch;
+static uint8_t capture_corr[MAX_CORRELATION_DATA];
+static size_t capture_corr_len;
+
+static int16_t samples[CONFIG_APP_CAPTURE_SAMPLES];
+static struct OutMsg blob;
+
+int capture_start(enum pd_channel ch, const struct Command *cmd)
+{
+    if (!atomic_cas(&busy, 0, 1)) {
+        return -EBUSY;
+    }
+
+    capture_ch = ch;
+    capture_corr_len = MIN(cmd->corr_len, sizeof(capture_corr));
+    memcpy(capture_corr, cmd->correlation_data, capture_corr_len);
+
+    k_sem_reset(&trigger_sem);
+    k_sem_give(&start_sem);
+
+    /* Pre-trigger samples take well under a second even at 128 SPS */
+    if (k_sem_take(&trigger_sem, K_SECONDS(1)) != 0) {
+        LOG_WRN("Capture pre-trigger window timed out");
+    }
+    return 0;
+}
+
+static void capture_publish(uint32_t period_ns, uint32_t trigger_ms)
+{
+    struct capture_header hdr = {
+        .magic = { 'P', 'C' },
+        .version = 2,
+        .channel = capture_ch,
+        .count = sys_cpu_to_le16(CONFIG_APP_CAPTURE_SAMPLES),
+        .trigger = sys_cpu_to_le16(CONFIG_APP_CAPTURE_PRE_SAMPLES),
+        .period_ns = sys_cpu_to_le32(period_ns),
+        .trigger_ms = sys_cpu_to_le32(trigger_ms),
+        .fsr_mv = sys_cpu_to_le16(photodiode_fsr_mv(capture_ch)),
+    };
+
+    memset(&blob, 0, sizeof(blob));
+    strncpy(blob.topic, CAPTURE_TOPIC, sizeof(blob.topic) - 1);
+    blob.msg_type = RESP_OK;
+    blob.qos = MQTT_QOS_1_AT_LEAST_ONCE;
+
+    memcpy(blob.payload, &hdr, sizeof(hdr));
+    for (int i = 0; i < CONFIG_APP_CAPTURE_SAMPLES; i++) {
+        sys_put_le16((uint16_t)samples[i], (uint8_t *)&blob.payload[sizeof(hdr) + i * sizeof(int16_t)]);
+    }
+    blob.payload_len = sizeof(hdr) + CONFIG_APP_CAPTURE_SAMPLES * sizeof(int16_t);
+
+    memcpy(blob.correlation_data, capture_corr, capture_corr_len);
+    blob.corr_len = capture_corr_len;
+
+    if (outbound_put(OUT_RESPONSE, &blob, K_SECONDS(1)) != 0) {
+        LOG_WRN("Capture dropped: response queue full");
+    }
+}
+
+static void capture_thread(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1); ARG_UNUSED(p2); ARG_UNUSED(p3);
+
+    while (1) {
+        uint32_t trigger_ms = 0;
+        uint32_t start;
+        uint64_t elapsed_ns;
+
+        k_sem_take(&start_sem, K_FOREVER);
+
+        photodiode_adc_lock();
+        start = k_cycle_get_32();
+        for (int i = 0; i < CONFIG_APP_CAPTURE_SAMPLES; i++) {
+            if (i == CONFIG_APP_CAPTURE_PRE_SAMPLES) {
+                trigger_ms = k_uptime_get_32();
+                k_sem_give(&trigger_sem);
+            }
+            (void)photodiode_read_channel(capture_ch, true, &samples[i]);
+        }
+        elapsed_ns = k_cyc_to_ns_floor64(k_cycle_get_32() - start);
+        photodiode_adc_unlock();
+
+        capture_publish((uint32_t)(elapsed_ns / CONFIG_APP_CAPTURE_SAMPLES), trigger_ms);
+        LOG_DBG("Captured %d samples in %llu us", CONFIG_APP_CAPTURE_SAMPLES, elapsed_ns / 1000);
+
+        atomic_clear(&busy);
+    }
+}
+
+K_THREAD_DEFINE(capture_tid, CAPTURE_STACK_SIZE,
+                capture_thread, NULL, NULL, NULL,
+                CAPTURE_PRIORITY, 0, 0);
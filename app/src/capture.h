@@ -0,0 +1,55 @@
+/*
+ * HiSPEC-TIB photodiode transient capture
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <zephyr/kernel.h>
+
+#include "command.h"
+#include "photodiode.h"
+
+#define CAPTURE_TOPIC "dt/hsfib-tib/capture"
+
+/*
+ * Blob published on CAPTURE_TOPIC, little-endian, with the triggering
+ * command's correlation data:
+ *
+ *   struct capture_header, then count int16 samples (INT16_MIN = failed read)
+ *
+ * Samples are evenly spaced by period_ns (the measured average); sample
+ * index trigger is the first taken after the trigger.
+ */
+struct capture_header {
+    char magic[2];          /* "PC" */
+    uint8_t version;        /* 2 */
+    uint8_t channel;        /* enum pd_channel */
+    uint16_t count;
+    uint16_t trigger;
+    uint32_t period_ns;
+    uint32_t trigger_ms;    /* k_uptime_get_32() at the trigger */
+    uint16_t fsr_mv;        /* full-scale range the samples were read on */
+} __packed;
+
+/**
+ * Capture a transient on @p ch around an actuation that follows. Samples
+ * the channel at the ADC's fastest rate for CONFIG_APP_CAPTURE_PRE_SAMPLES,
+ * marks the trigger and returns; the post-trigger window is recorded and
+ * published in the background. The 50 Hz loop pauses meanwhile.
+ *
+ * @param cmd  Command whose correlation data tags the blob
+ * @return 0 if armed, -EBUSY if a capture is already running
+ */
+#if defined(CONFIG_APP_CAPTURE)
+int capture_start(enum pd_channel ch, const struct Command *cmd);
+#else
+static inline int capture_start(enum pd_channel ch, const struct Command *cmd)
+{
+    return -ENOTSUP;
+}
+#endif
+
+#endif //CAPTURE_H
@@ -10,22 +10,33 @@
 
 #include "devices.h"
 #include "attenuator.h"
+#include "atten_cal.h"
 #include "maiman.h"
 #include "mems_switching.h"
-LOG_MODULE_REGISTER(command, LOG_LEVEL_DBG);
-
-
-/* one command at a time */
+#include "metrics.h"
+#include "persist.h"
+#include "boot.h"
+#include "history.h"
+#include "capture.h"
+#include "spectrum.h"
+#include "epoch.h"
+#include "lockin.h"
+#include "route_verify.h"
+#include "outbound.h"
+#include "photodiode.h"
+#include "supervisor.h"
+LOG_MODULE_REGISTER(command, CONFIG_APP_LOG_LEVEL);
+
+
+/* Command storage: the pending commands plus the one being executed */
+K_MEM_SLAB_DEFINE(command_slab, sizeof(struct Command), MAX_PENDING_COMMANDS + 1, 4);
+
+/* one command at a time; carries pointers into command_slab */
 K_MSGQ_DEFINE(inbound_queue,
-              sizeof(struct Command),
+              sizeof(struct Command *),
               MAX_PENDING_COMMANDS,      /* depth */
               4);     /* 4‐byte align */
 
-/* up to 8 pending publishes */
-K_MSGQ_DEFINE(outbound_queue,
-              sizeof(struct OutMsg),
-              8,
-              4);
 
 extern const struct gpio_dt_spec power_gpio;
 extern struct mems_switch mems_switches[MEMS_ROUTER_MAX_SWITCHES];
@@ -64,20 +75,41 @@ typedef enum laser_t {
 
 
 const struct DispatchEntry dispatch_table[] = {
-    { "memsroute",  memsroute_get,    memsroute_set    },
-    { "mems",       mems_get,    mems_set    },
-    { "laser",      laser_setting_get,laser_setting_set},
-    { "power",      power_get,        power_set        },
-    { "atten",      atten_setting_get,  atten_setting_set  },
-    { "status",     status_get,       NULL  },
-    { "sleep",      NULL,  sleep_set  }, // GET only
+    { "memsroute",  memsroute_get,    memsroute_set,    BOOT_HARDWARE },
+    { "mems",       mems_get,    mems_set,    BOOT_HARDWARE },
+    { "laser",      laser_setting_get,laser_setting_set, BOOT_HARDWARE },
+    { "power",      power_get,        power_set,        BOOT_HARDWARE },
+    { "atten",      atten_setting_get,  atten_setting_set,  BOOT_HARDWARE },
+    { "status",     status_get,       NULL,  BIT(BOOT_DEVICES) },
+    { "stats",      stats_get,        NULL,  0 },
+    { "sleep",      NULL,  sleep_set,  BOOT_HARDWARE }, // GET only
+    { "photodiode/history", photodiode_history_get, NULL, 0 },
+    { "photodiode/stream",  photodiode_stream_get,  photodiode_stream_set, 0 },
+    { "capture/arm", NULL, capture_arm_set, 0 },
+    { "spectrum",   NULL,             spectrum_set,  0 },
+    { "epoch",      epoch_get,        NULL,  0 },
+    { "lockin",     lockin_get,       lockin_set,  BOOT_HARDWARE },
 };
 
 
+/* Keys may carry a target after the command name: "mems/yj_ao_fei", or a
+ * laser wavelength straight after it, "laser1430yj/CURRENT". A key matches
+ * only if the name ends there, so "statusXYZ" and "memsroute" never reach
+ * "status" or "mems", whatever the table order.
+ */
+static bool key_matches(const char *name, const char *key)
+{
+    size_t len = strlen(name);
+
+    if (strncmp(name, key, len) != 0) {
+        return false;
+    }
+    return key[len] == '\0' || key[len] == '/' || isdigit((unsigned char)key[len]);
+}
+
 const struct DispatchEntry *find_dispatch(const char *key) {
-    //TODO
     for (size_t i = 0; i < ARRAY_SIZE(dispatch_table); ++i) {
-        if (strcmp(dispatch_table[i].key, key) == 0) {
+        if (key_matches(dispatch_table[i].key, key)) {
             return &dispatch_table[i];
         }
     }
@@ -86,7 +118,7 @@ const struct DispatchEntry *find_dispatch(const char *key) {
 
 
 struct OutMsg dispatch_command(const struct Command *cmd) {
-    LOG_INF("Dispatching: %s", cmd->key);
+    LOG_DBG("Dispatching: %s", cmd->key);
     struct OutMsg r;
 
     const struct DispatchEntry *entry = find_dispatch(cmd->key);
@@ -94,7 +126,13 @@ struct OutMsg dispatch_command(const struct Command *cmd) {
         r = unknown_response(cmd);
     } else {
         DispatchFunc func = (cmd->msg_type == SET) ? entry->set_handler : entry->get_handler;
-        r = func==NULL ? unsupported_response(cmd) : func(cmd);
+        if (func == NULL) {
+            r = unsupported_response(cmd);
+        } else if (!boot_ready(entry->requires)) {
+            r = not_ready_response(cmd);
+        } else {
+            r = func(cmd);
+        }
     }
     return r;
 }
@@ -225,6 +263,7 @@ bool power_enabled() {
 bool enable_power() {
     if (power_enabled())
         return false;
+    epoch_begin();
     int err = gpio_pin_set_dt(&power_gpio, 1);
     if (err) {
         LOG_ERR("Failed to set POWER_GPIO high\n");
@@ -236,14 +275,43 @@ bool disable_power() {
     if (!power_enabled())
         return false;
     //TODO set POWER_GPIO low
+    lockin_stop();
+    epoch_begin();
     int err = gpio_pin_set_dt(&power_gpio, 0);
     if (err) {
         LOG_ERR("Failed to set POWER_GPIO low\n");
     }
+    epoch_bump();
     return true;
 
 }
 
+/* Power the lasers if needed and give a fresh boot its saved setpoints */
+void power_up_lasers() {
+    if (enable_power()) {
+        wait_laser_boot();
+        persist_restore_lasers();
+        epoch_bump();
+    }
+}
+
+/* Paths and switches are named yj_* or hk_* after the photodiode they feed */
+enum pd_channel pd_channel_for_name(const char *name) {
+    return strncasecmp(name, "hk", 2) == 0 ? PD_HK : PD_YJ;
+}
+
+enum pd_channel pd_channel_for_laser(laser_t laser_id) {
+    return (laser_id == LASER_1430_HK || laser_id == LASER_1510_H ||
+            laser_id == LASER_2330_K) ? PD_HK : PD_YJ;
+}
+
+/* Record the settling transient of the actuation about to happen */
+void capture_actuation(enum pd_channel ch, const struct Command *cmd) {
+    if (IS_ENABLED(CONFIG_APP_CAPTURE_ON_ACTUATION)) {
+        (void)capture_start(ch, cmd);
+    }
+}
+
 
 
 
@@ -266,6 +334,11 @@ struct OutMsg unsupported_response(const struct Command *cmd) {
     return _msg_builder(cmd, RESP_ERROR, err);
 }
 
+struct OutMsg not_ready_response(const struct Command *cmd) {
+    const char *err = "{\"error\":\"Not ready\"}";
+    return _msg_builder(cmd, RESP_ERROR, err);
+}
+
 struct OutMsg busy_response(const struct Command *cmd) {
     const char *err = "{\"error\":\"busy\"}";
     return _msg_builder(cmd, RESP_ERROR,  err);
@@ -314,23 +387,62 @@ struct OutMsg memsroute_get(const struct Command *cmd)
     return _msg_builder(cmd, RESP_OK, buf);
 }
 
+/* memsroute set arguments; verify, timeout_ms and expect are optional */
+struct memsroute_args {
+    char input[MEMS_SOURCEDEST_MAX_LEN];
+    char output[MEMS_SOURCEDEST_MAX_LEN];
+    bool verify;
+    uint32_t timeout_ms;
+    char expect[8];
+};
+
 struct OutMsg memsroute_set(const struct Command *cmd) {
 
-    // Parse { "value": [input_string, output_string] }
-    struct mems_route_id route_id = {0};
+    // Parse { "input": ..., "output": ..., "verify": bool, "timeout_ms": N, "expect": "rise|fall|change" }
+    struct memsroute_args args = { .timeout_ms = CONFIG_APP_ROUTE_VERIFY_TIMEOUT_MS };
     struct json_obj_descr d[] = {
-        JSON_OBJ_DESCR_PRIM(struct mems_route_id, input, JSON_TOK_STRING),
-        JSON_OBJ_DESCR_PRIM(struct mems_route_id, output, JSON_TOK_STRING),
+        JSON_OBJ_DESCR_PRIM(struct memsroute_args, input, JSON_TOK_STRING),
+        JSON_OBJ_DESCR_PRIM(struct memsroute_args, output, JSON_TOK_STRING),
+        JSON_OBJ_DESCR_PRIM(struct memsroute_args, verify, JSON_TOK_TRUE),
+        JSON_OBJ_DESCR_PRIM(struct memsroute_args, timeout_ms, JSON_TOK_NUMBER),
+        JSON_OBJ_DESCR_PRIM(struct memsroute_args, expect, JSON_TOK_STRING),
     };
-    if (json_obj_parse((char *) cmd->payload, cmd->payload_len, d, ARRAY_SIZE(d), &route_id) < 0) {
+    int parsed = json_obj_parse((char *) cmd->payload, cmd->payload_len, d, ARRAY_SIZE(d), &args);
+    if (parsed < 0 || (parsed & 0x3) != 0x3) {
         return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Failed to parse JSON input or output\"}");
     }
 
-    const struct mems_route *route = mems_router_get_route(&router, route_id.input, route_id.output);
+    const struct mems_route *route = mems_router_get_route(&router, args.input, args.output);
     if (!route) {
         return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Invalid Route\"}");
     }
 
+    enum pd_channel ch = pd_channel_for_name(args.output);
+    enum verify_expect expect = VERIFY_CHANGE;
+    struct verify_result res;
+
+    if (args.verify) {
+        /* Stay well inside the executor's watchdog deadline */
+        args.timeout_ms = MIN(args.timeout_ms, CONFIG_APP_SUPERVISOR_EXECUTOR_DEADLINE_MS / 2);
+        if (strcasecmp(args.expect, "rise") == 0) {
+            expect = VERIFY_RISE;
+        } else if (strcasecmp(args.expect, "fall") == 0) {
+            expect = VERIFY_FALL;
+        }
+        /* Baseline and transition must be read on the same range */
+        photodiode_gain_hold();
+        if (verify_baseline(ch, &res) != 0) {
+            photodiode_gain_release();
+            return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Photodiode read failed\"}");
+        }
+    } else {
+        /* Verification reads the ADC itself; a capture would hold it */
+        capture_actuation(ch, cmd);
+    }
+
+    uint32_t start = k_cycle_get_32();
+    epoch_begin();
+
     for (uint8_t i = 0; i < route->num_steps; ++i) {
         const struct mems_route_step *step = &route->steps[i];
         struct mems_switch *sw = mems_router_find_switch(&router, step->switch_name);
@@ -338,21 +450,51 @@ struct OutMsg memsroute_set(const struct Command *cmd) {
 
         if (sw==NULL) {
             LOG_ERR("Internal route error: Switch %s not found\n", step->switch_name);
+            epoch_bump();
+            if (args.verify) {
+                photodiode_gain_release();
+            }
             return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Internal route error\"}");
         }
 
         rc = mems_switch_set_state(sw, step->state);
 
         if (rc != 0) {
+            // Earlier steps of the route may already have moved
+            epoch_bump();
+            if (args.verify) {
+                photodiode_gain_release();
+            }
             char payload[MAX_PAYLOAD_LEN]={0};
             snprintf(payload, MAX_PAYLOAD_LEN, "{\"error\":\"Setting switch %s to %c failed\"}",
                 step->switch_name,  step->state);
             return _msg_builder(cmd, RESP_ERROR, payload);
         }
-        LOG_INF("Set switch %s to %c\n", step->switch_name, step->state);
+        LOG_DBG("Set switch %s to %c", step->switch_name, step->state);
     }
+    uint32_t switch_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    persist_save_mems();
+    epoch_bump();
 
-    return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
+    if (!args.verify) {
+        return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
+    }
+
+    char payload[MAX_PAYLOAD_LEN]={0};
+    int rc = verify_transition(ch, expect, start, args.timeout_ms, &res);
+    photodiode_gain_release();
+    if (rc == 0) {
+        snprintf(payload, MAX_PAYLOAD_LEN,
+                 "{\"status\":\"OK\",\"settle_us\":%u,\"switch_us\":%u,\"before\":%d,\"after\":%d}",
+                 res.settle_us, switch_us, res.before, res.after);
+        return _msg_builder(cmd, RESP_OK, payload);
+    }
+
+    snprintf(payload, MAX_PAYLOAD_LEN,
+             "{\"error\":\"%s\",\"timeout_ms\":%u,\"before\":%d,\"last\":%d}",
+             rc == -ETIMEDOUT ? "No transition" : "Photodiode read failed",
+             args.timeout_ms, res.before, res.after);
+    return _msg_builder(cmd, RESP_ERROR, payload);
 }
 
 
@@ -402,9 +544,14 @@ struct OutMsg mems_set(const struct Command *cmd) {
         return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Invalid switch name\"}");
     }
 
+    capture_actuation(pd_channel_for_name(mems_switch), cmd);
+    epoch_begin();
     if (mems_switch_set_state(sw, in_data.value[0])!=0) {
+        epoch_bump();
         return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Invalid switch state\"}");
     }
+    persist_save_mems();
+    epoch_bump();
 
     return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
 }
@@ -428,9 +575,7 @@ struct OutMsg laser_setting_get(const struct Command *cmd) {
         return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Invalid laser setting\"}");
     }
 
-    if (enable_power()) {
-        wait_laser_boot();
-    }
+    power_up_lasers();
 
     uint16_t value = 0;
     if (!maiman_read_u16(&driver, addr, &value)) {
@@ -470,18 +615,45 @@ struct OutMsg laser_setting_set(const struct Command *cmd) {
         return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Invalid laser setting\"}");
     }
 
-    if (enable_power()) {
-        wait_laser_boot();
-    }
+    power_up_lasers();
 
+    epoch_begin();
     if (!maiman_write_u16(&driver, addr, in_data.value) ) {
+        epoch_bump();
         return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"set_driver_setting failed\"}");
     }
+    persist_save_laser(driver.node_id, addr, in_data.value);
+    epoch_laser_written(driver.node_id, addr, in_data.value);
+    epoch_bump();
 
     return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
 }
 
 
+/* Append "name":[c0,c1,...] for one calibration curve */
+static int format_coeffs(char *buf, size_t len, const char *name, const double *coeffs) {
+    size_t offset;
+    int written;
+
+    written = snprintf(buf, len, "\"%s\":[", name);
+    if (written < 0 || written >= (int)len) {
+        return -ENOMEM;
+    }
+    offset = written;
+    for (int i = 0; i < ATTEN_NUM_COEFFS; i++) {
+        written = snprintf(buf + offset, len - offset, "%s%.6g", i > 0 ? "," : "", coeffs[i]);
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+    written = snprintf(buf + offset, len - offset, "]");
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    return offset + written;
+}
+
 struct OutMsg atten_setting_get(const struct Command *cmd) {
 
     // Extract laser### and <setting> from key
@@ -497,16 +669,26 @@ struct OutMsg atten_setting_get(const struct Command *cmd) {
     }
 
     char payload[MAX_PAYLOAD_LEN]={0};
-    if (strcasecmp(setting, "coeff")) {
-        snprintf(payload, MAX_PAYLOAD_LEN,
-                 "{\"db2volt\":[%.4f,%.4f,%.4f],\"volt2db\":[%.4f,%.4f,%.4f]}",
-                 attenuators[laser_id].coeff_db_to_volt[0],
-                 attenuators[laser_id].coeff_db_to_volt[1],
-                 attenuators[laser_id].coeff_db_to_volt[2],
-                 attenuators[laser_id].coeff_volt_to_db[0],
-                 attenuators[laser_id].coeff_volt_to_db[1],
-                 attenuators[laser_id].coeff_volt_to_db[2]);
-    } else if (strcasecmp(setting, "value") || strcasecmp(setting, "valuedb")) {
+    if (strcasecmp(setting, "coeff") == 0) {
+        int offset = 1;
+        int written;
+
+        payload[0] = '{';
+        written = format_coeffs(payload + offset, MAX_PAYLOAD_LEN - offset - 2, "db2volt",
+                                attenuators[laser_id].coeff_db_to_volt);
+        if (written < 0) {
+            return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Payload overflow\"}");
+        }
+        offset += written;
+        payload[offset++] = ',';
+        written = format_coeffs(payload + offset, MAX_PAYLOAD_LEN - offset - 1, "volt2db",
+                                attenuators[laser_id].coeff_volt_to_db);
+        if (written < 0) {
+            return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Payload overflow\"}");
+        }
+        offset += written;
+        payload[offset] = '}';
+    } else if (strcasecmp(setting, "value") == 0 || strcasecmp(setting, "valuedb") == 0) {
         double db, voltage;
         attenuator_get(&attenuators[laser_id], &db, false);
         attenuator_get(&attenuators[laser_id], &voltage, true);
@@ -518,6 +700,81 @@ struct OutMsg atten_setting_get(const struct Command *cmd) {
     return _msg_builder(cmd, RESP_OK, payload);
 }
 
+/* Sweep result; only the executor calibrates, and it is too big for its stack */
+static struct atten_cal_result cal_result;
+
+static struct OutMsg atten_calibrate_set(const struct Command *cmd, laser_t laser_id) {
+
+    // Optional { "points": 16, "vmin_mv": 0, "vmax_mv": 4096, "settle_ms": 20 }
+    struct calibrate_args {
+        int32_t points;
+        int32_t vmin_mv;
+        int32_t vmax_mv;
+        int32_t settle_ms;
+    } args = {
+        .points = 16,
+        .vmin_mv = 0,
+        .vmax_mv = (int32_t)(MAX_VOLTAGE * 1000),
+        .settle_ms = 20,
+    };
+    const struct json_obj_descr d[] = {
+        JSON_OBJ_DESCR_PRIM(struct calibrate_args, points, JSON_TOK_NUMBER),
+        JSON_OBJ_DESCR_PRIM(struct calibrate_args, vmin_mv, JSON_TOK_NUMBER),
+        JSON_OBJ_DESCR_PRIM(struct calibrate_args, vmax_mv, JSON_TOK_NUMBER),
+        JSON_OBJ_DESCR_PRIM(struct calibrate_args, settle_ms, JSON_TOK_NUMBER),
+    };
+
+    if (cmd->payload_len > 0 &&
+        json_obj_parse((char *) cmd->payload, cmd->payload_len, d, ARRAY_SIZE(d), &args) < 0) {
+        return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Improper arguments\"}");
+    }
+    if (args.settle_ms < 0 || args.settle_ms > 200) {
+        return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"settle_ms out of range\"}");
+    }
+
+    struct atten_cal_params params = {
+        .points = args.points,
+        .vmin = args.vmin_mv / 1000.0,
+        .vmax = args.vmax_mv / 1000.0,
+        .settle_ms = args.settle_ms,
+    };
+    epoch_begin();
+    int rc = atten_calibrate(&attenuators[laser_id], pd_channel_for_laser(laser_id),
+                             &params, &cal_result);
+    epoch_bump();
+    if (rc == -EINVAL) {
+        return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Improper arguments\"}");
+    } else if (rc == -ERANGE) {
+        return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Fit failed, check laser and route\"}");
+    } else if (rc != 0) {
+        return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Sweep failed\"}");
+    }
+    persist_save_atten(laser_id, &attenuators[laser_id]);
+
+    char payload[MAX_PAYLOAD_LEN]={0};
+    int offset = snprintf(payload, MAX_PAYLOAD_LEN,
+                          "{\"status\":\"OK\",\"points\":%d,\"rms_db\":%.3f,\"max_db\":%.3f,"
+                          "\"rms_v\":%.4f,\"max_v\":%.4f,\"res_db\":[",
+                          cal_result.n, cal_result.rms_db, cal_result.max_db,
+                          cal_result.rms_v, cal_result.max_v);
+    for (int i = 0; i < cal_result.n && offset < MAX_PAYLOAD_LEN; i++) {
+        offset += snprintf(payload + offset, MAX_PAYLOAD_LEN - offset, "%s%.3f",
+                           i > 0 ? "," : "", cal_result.res_db[i]);
+    }
+    if (offset < MAX_PAYLOAD_LEN) {
+        offset += snprintf(payload + offset, MAX_PAYLOAD_LEN - offset, "]}");
+    }
+    if (offset >= MAX_PAYLOAD_LEN) {
+        // Residuals don't fit; the summary still does
+        snprintf(payload, MAX_PAYLOAD_LEN,
+                 "{\"status\":\"OK\",\"points\":%d,\"rms_db\":%.3f,\"max_db\":%.3f,"
+                 "\"rms_v\":%.4f,\"max_v\":%.4f}",
+                 cal_result.n, cal_result.rms_db, cal_result.max_db,
+                 cal_result.rms_v, cal_result.max_v);
+    }
+    return _msg_builder(cmd, RESP_OK, payload);
+}
+
 struct OutMsg atten_setting_set(const struct Command *cmd) {
 
     // Extract laser### and <setting>
@@ -534,9 +791,9 @@ struct OutMsg atten_setting_set(const struct Command *cmd) {
 
     // Parse value
     struct coeffs {
-        float db2volt[3];
+        float db2volt[ATTEN_NUM_COEFFS];
         size_t db2volt_len;
-        float volt2db[3];
+        float volt2db[ATTEN_NUM_COEFFS];
         size_t volt2db_len;
     };
 
@@ -545,32 +802,38 @@ struct OutMsg atten_setting_set(const struct Command *cmd) {
         float value;
     };
 
-    if (strcasecmp(setting, "coeff")) {
+    if (strcasecmp(setting, "calibrate") == 0) {
+        return atten_calibrate_set(cmd, laser_id);
+
+    } else if (strcasecmp(setting, "coeff") == 0) {
 
         struct coeffs parsed_coeffs = {0};
 
         const struct json_obj_descr coeff_descr[] = {
-            JSON_OBJ_DESCR_ARRAY(struct coeffs, db2volt, 3, db2volt_len, JSON_TOK_FLOAT),
-            JSON_OBJ_DESCR_ARRAY(struct coeffs, volt2db, 3, volt2db_len, JSON_TOK_FLOAT),
+            JSON_OBJ_DESCR_ARRAY(struct coeffs, db2volt, ATTEN_NUM_COEFFS, db2volt_len, JSON_TOK_FLOAT),
+            JSON_OBJ_DESCR_ARRAY(struct coeffs, volt2db, ATTEN_NUM_COEFFS, volt2db_len, JSON_TOK_FLOAT),
         };
 
+        // Lower-order curves may omit their trailing zero coefficients
         if (json_obj_parse((char *) cmd->payload, cmd->payload_len, coeff_descr,
                                  ARRAY_SIZE(coeff_descr), &parsed_coeffs) < 0 ||
-                                 parsed_coeffs.db2volt_len != 3 || parsed_coeffs.volt2db_len != 3) {
+                                 parsed_coeffs.db2volt_len == 0 || parsed_coeffs.volt2db_len == 0) {
             return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Improper arguments\"}");
         }
 
         double db;
         attenuator_get(&attenuators[laser_id], &db, false);
 
-        for (int i=0; i<3; i++) {
+        for (int i=0; i<ATTEN_NUM_COEFFS; i++) {
             attenuators[laser_id].coeff_db_to_volt[i]=parsed_coeffs.db2volt[i];
             attenuators[laser_id].coeff_volt_to_db[i]=parsed_coeffs.volt2db[i];
         }
 
+        capture_actuation(pd_channel_for_laser(laser_id), cmd);
+        epoch_begin();
         attenuator_set(&attenuators[laser_id], db, false);
 
-    } else if (strcasecmp(setting, "value")) {
+    } else if (strcasecmp(setting, "value") == 0) {
 
         struct json_value_float in_data = {0};
         struct json_obj_descr d[] = {
@@ -579,9 +842,11 @@ struct OutMsg atten_setting_set(const struct Command *cmd) {
         if (json_obj_parse((char *) cmd->payload, cmd->payload_len, d, 1, &in_data) < 0) {
             return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Missing setting value\"}");
         }
+        capture_actuation(pd_channel_for_laser(laser_id), cmd);
+        epoch_begin();
         attenuator_set(&attenuators[laser_id], in_data.value, true);
 
-    } else if (strcasecmp(setting, "valuedb")) {
+    } else if (strcasecmp(setting, "valuedb") == 0) {
         struct json_value_float in_data = {0};
         struct json_obj_descr d[] = {
             JSON_OBJ_DESCR_PRIM(struct json_value_float, value, JSON_TOK_NUMBER)
@@ -589,12 +854,16 @@ struct OutMsg atten_setting_set(const struct Command *cmd) {
         if (json_obj_parse((char *) cmd->payload, cmd->payload_len, d, 1, &in_data) < 0) {
             return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Missing setting value\"}");
         }
+        capture_actuation(pd_channel_for_laser(laser_id), cmd);
+        epoch_begin();
         attenuator_set(&attenuators[laser_id], in_data.value, false);
 
     } else {
         return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Invalid setting\"}");
     }
 
+    persist_save_atten(laser_id, &attenuators[laser_id]);
+    epoch_bump();
     return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
 }
 
@@ -606,6 +875,31 @@ struct OutMsg status_get(const struct Command *cmd) {
 }
 
 
+struct OutMsg stats_get(const struct Command *cmd) {
+
+    // Optional { "value": "threads" } selects the per-thread table
+    struct json_value_string in_data = {0};
+    struct json_obj_descr d[] = {
+        JSON_OBJ_DESCR_PRIM(struct json_value_string, value, JSON_TOK_STRING),
+    };
+    json_obj_parse((char *) cmd->payload, cmd->payload_len, d, ARRAY_SIZE(d), &in_data);
+
+    char payload[MAX_PAYLOAD_LEN]={0};
+    int rc;
+    if (strcasecmp(in_data.value, "threads") == 0) {
+        rc = metrics_format_threads(payload, sizeof(payload));
+    } else if (strcasecmp(in_data.value, "i2c") == 0) {
+        rc = metrics_format_i2c(payload, sizeof(payload));
+    } else {
+        rc = metrics_format(payload, sizeof(payload));
+    }
+    if (rc < 0) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"overflow building JSON\"}");
+    }
+    return _msg_builder(cmd, RESP_OK, payload);
+}
+
+
 struct OutMsg power_get(const struct Command *cmd) {
     char payload[MAX_PAYLOAD_LEN]={0};
     snprintf(payload, MAX_PAYLOAD_LEN, "{\"power\":%s}", power_enabled() ? "true" : "false");
@@ -625,7 +919,7 @@ struct OutMsg power_set(const struct Command *cmd) {
         return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Missing setting value\"}");
     }
 
-    if (args.value) enable_power();
+    if (args.value) power_up_lasers();
     else disable_power();
     return _msg_builder(cmd, RESP_ERROR,"{\"status\":\"OK\"}");
 }
@@ -642,6 +936,377 @@ struct OutMsg sleep_set(const struct Command *cmd) {
     }
 
     //TODO do anything necessary to grasefully shupdown the lasers.
-    if (args.value) disable_power();
+    if (args.value) {
+        persist_flush();
+        disable_power();
+    }
     return _msg_builder(cmd, RESP_ERROR,"{\"status\":\"OK\"}");
-}
\ No newline at end of file
+}
+
+
+/* Samples per history chunk. Worst case per sample is 31 bytes
+ * ("4294967295,-32768.00,-32768.00" plus separators), so 12 leave room for
+ * the header within MAX_PAYLOAD_LEN.
+ */
+#define HISTORY_CHUNK_SAMPLES 12
+
+struct history_query {
+    int64_t start;
+    int64_t end;
+    uint32_t max;
+};
+
+/* Built here rather than on the executor stack */
+static struct history_sample history_buf[HISTORY_CHUNK_SAMPLES];
+static char history_payload[MAX_PAYLOAD_LEN];
+static struct OutMsg history_msg;
+
+static int format_history_chunk(char *buf, size_t len, uint32_t chunk, int64_t t0_ms,
+                                const struct history_sample *samples, size_t n,
+                                bool last, uint32_t total)
+{
+    static const char *const fields[] = { "dt", "yj", "hk" };
+    size_t offset;
+    int written;
+
+    written = snprintf(buf, len, "{\"seq\":%u,\"t0\":%lld", chunk, t0_ms);
+    if (written < 0 || written >= (int)len) {
+        return -ENOMEM;
+    }
+    offset = written;
+
+    for (int f = 0; f < ARRAY_SIZE(fields); f++) {
+        written = snprintf(buf + offset, len - offset, ",\"%s\":[", fields[f]);
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+
+        for (size_t i = 0; i < n; i++) {
+            const char *sep = i > 0 ? "," : "";
+
+            if (f == 0) {
+                written = snprintf(buf + offset, len - offset, "%s%u", sep,
+                                   i > 0 ? samples[i].t_ms - samples[i - 1].t_ms : 0);
+            } else {
+                /* Stored raw on the range it was read on */
+                float v = f == 1 ? photodiode_normalize(PD_YJ, samples[i].yj, samples[i].yj_range)
+                                 : photodiode_normalize(PD_HK, samples[i].hk, samples[i].hk_range);
+
+                written = snprintf(buf + offset, len - offset, "%s%.2f", sep, (double)v);
+            }
+            if (written < 0 || written >= (int)(len - offset)) {
+                return -ENOMEM;
+            }
+            offset += written;
+        }
+
+        written = snprintf(buf + offset, len - offset, "]");
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+
+    if (last) {
+        written = snprintf(buf + offset, len - offset, ",\"n\":%u,\"done\":true}", total);
+    } else {
+        written = snprintf(buf + offset, len - offset, "}");
+    }
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    return offset + written;
+}
+
+struct OutMsg photodiode_history_get(const struct Command *cmd) {
+
+    // Parse optional { "start": epoch ms, "end": epoch ms, "max": samples }
+    struct history_query q = { .start = 0, .end = INT64_MAX, .max = UINT32_MAX };
+    const struct json_obj_descr d[] = {
+        JSON_OBJ_DESCR_PRIM(struct history_query, start, JSON_TOK_INT64),
+        JSON_OBJ_DESCR_PRIM(struct history_query, end, JSON_TOK_INT64),
+        JSON_OBJ_DESCR_PRIM(struct history_query, max, JSON_TOK_NUMBER),
+    };
+    if (json_obj_parse((char *) cmd->payload, cmd->payload_len, d, ARRAY_SIZE(d), &q) < 0) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Improper arguments\"}");
+    }
+
+    /* Samples carry uptime; map the requested wall-clock range onto it */
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    int64_t now = k_uptime_get();
+    int64_t boot_epoch_ms = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000 - now;
+
+    uint32_t first, end;
+    history_range(&first, &end);
+
+    int64_t now_epoch_ms = boot_epoch_ms + now;
+    uint32_t seq = first;
+    if (q.start > boot_epoch_ms) {
+        seq = history_find((uint32_t)(MIN(q.start, now_epoch_ms) - boot_epoch_ms));
+    }
+    if (q.end < now_epoch_ms) {
+        end = q.end > boot_epoch_ms ? history_find((uint32_t)(q.end - boot_epoch_ms)) : first;
+    }
+    if (end > seq && end - seq > q.max) {
+        end = seq + q.max;
+    }
+
+    /* Stream full chunks as separate responses; the last one is returned */
+    const k_timeout_t wait = K_MSEC(CONFIG_APP_SUPERVISOR_EXECUTOR_DEADLINE_MS / 2);
+    uint32_t chunk = 0;
+    uint32_t total = 0;
+
+    while (1) {
+        uint32_t from = seq;
+        size_t n = history_copy(&seq, end, history_buf, HISTORY_CHUNK_SAMPLES);
+        bool last = n < HISTORY_CHUNK_SAMPLES || seq >= end;
+
+        if (seq - from > n) {
+            LOG_WRN("History overwritten during read; %u samples skipped", seq - from - n);
+        }
+        total += n;
+
+        int64_t t0 = n > 0 ? boot_epoch_ms + history_buf[0].t_ms : 0;
+        if (format_history_chunk(history_payload, sizeof(history_payload), chunk, t0,
+                                 history_buf, n, last, total) < 0) {
+            return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"overflow building JSON\"}");
+        }
+        if (last) {
+            return _msg_builder(cmd, RESP_OK, history_payload);
+        }
+
+        history_msg = _msg_builder(cmd, RESP_OK, history_payload);
+        while (outbound_put(OUT_RESPONSE, &history_msg, wait) != 0) {
+            supervisor_checkin(SUPERVISOR_EXECUTOR);
+        }
+        supervisor_checkin(SUPERVISOR_EXECUTOR);
+        chunk++;
+    }
+}
+
+struct OutMsg photodiode_stream_get(const struct Command *cmd) {
+    char payload[MAX_PAYLOAD_LEN]={0};
+    snprintf(payload, MAX_PAYLOAD_LEN, "{\"value\":%u}", photodiode_get_stream_divider());
+    return _msg_builder(cmd, RESP_OK, payload);
+}
+
+struct OutMsg photodiode_stream_set(const struct Command *cmd) {
+
+    // Parse { "value": N }: publish every Nth sample, 0 stops streaming
+    struct json_value_uint16 in_data = {0};
+    struct json_obj_descr d[] = {
+        JSON_OBJ_DESCR_PRIM(struct json_value_uint16, value, JSON_TOK_NUMBER)
+    };
+    if (json_obj_parse((char *) cmd->payload, cmd->payload_len, d, 1, &in_data) < 0) {
+        return _msg_builder(cmd, RESP_ERROR,"{\"error\":\"Missing setting value\"}");
+    }
+
+    photodiode_set_stream_divider(in_data.value);
+    return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
+}
+
+struct OutMsg capture_arm_set(const struct Command *cmd) {
+
+    // Parse { "value": "yj" | "hk" }
+    struct json_value_string in_data = {0};
+    struct json_obj_descr d[] = {
+        JSON_OBJ_DESCR_PRIM(struct json_value_string, value, JSON_TOK_STRING),
+    };
+    if (json_obj_parse((char *) cmd->payload, cmd->payload_len, d, ARRAY_SIZE(d), &in_data) < 0) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Missing channel\"}");
+    }
+    if (strcasecmp(in_data.value, "yj") != 0 && strcasecmp(in_data.value, "hk") != 0) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Invalid channel\"}");
+    }
+
+    int rc = capture_start(pd_channel_for_name(in_data.value), cmd);
+    if (rc == -EBUSY) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Capture in progress\"}");
+    } else if (rc != 0) {
+        return unsupported_response(cmd);
+    }
+    return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
+}
+
+struct spectrum_args {
+    char value[8];
+    uint32_t peaks;
+    uint32_t period_s;
+};
+
+struct OutMsg spectrum_set(const struct Command *cmd) {
+
+    // Parse { "value": "yj" | "hk" | "stop", "peaks": N, "period_s": N }
+    struct spectrum_args args = { .peaks = 5 };
+    struct json_obj_descr d[] = {
+        JSON_OBJ_DESCR_PRIM(struct spectrum_args, value, JSON_TOK_STRING),
+        JSON_OBJ_DESCR_PRIM(struct spectrum_args, peaks, JSON_TOK_NUMBER),
+        JSON_OBJ_DESCR_PRIM(struct spectrum_args, period_s, JSON_TOK_NUMBER),
+    };
+    int parsed = json_obj_parse((char *) cmd->payload, cmd->payload_len, d, ARRAY_SIZE(d), &args);
+    if (parsed < 0 || !(parsed & BIT(0))) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Missing channel\"}");
+    }
+
+    if (strcasecmp(args.value, "stop") == 0) {
+        spectrum_stop();
+        return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
+    }
+    if (strcasecmp(args.value, "yj") != 0 && strcasecmp(args.value, "hk") != 0) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Invalid channel\"}");
+    }
+    if (args.peaks > SPECTRUM_MAX_PEAKS ||
+        (args.period_s != 0 && args.period_s < SPECTRUM_MIN_PERIOD_S)) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Improper arguments\"}");
+    }
+
+    int rc = spectrum_start(pd_channel_for_name(args.value), args.peaks, args.period_s, cmd);
+    if (rc == -EBUSY) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Spectrum in progress\"}");
+    } else if (rc != 0) {
+        return unsupported_response(cmd);
+    }
+    return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
+}
+
+struct OutMsg epoch_get(const struct Command *cmd) {
+
+    // Optional { "value": N } selects an earlier epoch; default is the current one
+    struct epoch_query {
+        int64_t value;
+    } q = {0};
+    const struct json_obj_descr d[] = {
+        JSON_OBJ_DESCR_PRIM(struct epoch_query, value, JSON_TOK_INT64),
+    };
+    int parsed = json_obj_parse((char *) cmd->payload, cmd->payload_len, d, ARRAY_SIZE(d), &q);
+    if (parsed < 0) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Improper arguments\"}");
+    }
+
+    uint32_t epoch = (parsed & BIT(0)) ? (uint32_t)q.value : epoch_latest();
+    struct epoch_state state;
+    if (q.value < 0 || epoch_lookup(epoch, &state) != 0) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Epoch not held\"}");
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    int64_t boot_ms = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000 - k_uptime_get();
+
+    char payload[MAX_PAYLOAD_LEN]={0};
+    if (epoch_format(&state, boot_ms, payload, MAX_PAYLOAD_LEN) < 0) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Payload overflow\"}");
+    }
+    return _msg_builder(cmd, RESP_OK, payload);
+}
+
+struct OutMsg lockin_get(const struct Command *cmd) {
+    struct lockin_status st;
+    lockin_get_status(&st);
+
+    char payload[MAX_PAYLOAD_LEN]={0};
+    snprintf(payload, MAX_PAYLOAD_LEN,
+             "{\"running\":%s,\"node\":%u,\"ch\":\"%s\",\"freq_mhz\":%u,\"tau_ms\":%u,"
+             "\"amplitude\":%.2f,\"phase_deg\":%.1f,\"dc\":%.1f,\"n\":%u,\"run_ms\":%u}",
+             st.running ? "true" : "false", st.node, st.channel == PD_HK ? "hk" : "yj",
+             st.freq_mhz, st.tau_ms, (double)st.amplitude, (double)st.phase_deg,
+             (double)st.dc, st.samples, st.run_ms);
+    return _msg_builder(cmd, RESP_OK, payload);
+}
+
+struct lockin_args {
+    bool value;
+    char laser[16];
+    uint32_t freq_mhz;
+    uint32_t tau_ms;
+};
+
+/* Square wave at the reference: pulse length is half the period, in the
+ * ms the duration register holds, capped at what the register fits
+ */
+static bool lockin_modulate(maiman_driver_t *driver, uint32_t freq_mhz) {
+    float freq = freq_mhz / 1000.0f;
+    float duration = MIN(500.0f / freq, 65.535f);
+
+    if (!maiman_set_frequency(driver, freq) || !maiman_set_duration(driver, duration) ||
+        !maiman_start_device(driver)) {
+        return false;
+    }
+    epoch_laser_written(driver->node_id, REG_FREQUENCY, (uint16_t)(freq * DIVIDER_FREQUENCY));
+    epoch_laser_written(driver->node_id, REG_DURATION, (uint16_t)(duration * DIVIDER_DURATION));
+    epoch_laser_written(driver->node_id, REG_STATE_OF_DEVICE_COMMAND, MODBUS_START_COMMAND_VALUE);
+    return true;
+}
+
+struct OutMsg lockin_set(const struct Command *cmd) {
+
+    // Parse { "value": true, "laser": "1510h", "freq_mhz": N, "tau_ms": N } or { "value": false }
+    struct lockin_args args = { .freq_mhz = 20000, .tau_ms = 1000 };
+    struct json_obj_descr d[] = {
+        JSON_OBJ_DESCR_PRIM(struct lockin_args, value, JSON_TOK_TRUE),
+        JSON_OBJ_DESCR_PRIM(struct lockin_args, laser, JSON_TOK_STRING),
+        JSON_OBJ_DESCR_PRIM(struct lockin_args, freq_mhz, JSON_TOK_NUMBER),
+        JSON_OBJ_DESCR_PRIM(struct lockin_args, tau_ms, JSON_TOK_NUMBER),
+    };
+    int parsed = json_obj_parse((char *) cmd->payload, cmd->payload_len, d, ARRAY_SIZE(d), &args);
+    if (parsed < 0 || !(parsed & BIT(0))) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Missing setting value\"}");
+    }
+
+    struct lockin_status st;
+    lockin_get_status(&st);
+
+    if (!args.value) {
+        if (!st.running) {
+            return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
+        }
+        lockin_stop();
+
+        maiman_driver_t driver = { .node_id = st.node };
+        epoch_begin();
+        bool stopped = maiman_stop_device(&driver);
+        if (stopped) {
+            epoch_laser_written(st.node, REG_STATE_OF_DEVICE_COMMAND, MODBUS_STOP_COMMAND_VALUE);
+        }
+        epoch_bump();
+        if (!stopped) {
+            return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Failed to stop laser\"}");
+        }
+        return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
+    }
+
+    if (!(parsed & BIT(1))) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Missing laser\"}");
+    }
+    laser_t laser_id = get_laser_channel(args.laser);
+    if (laser_id == LASER_UNKNOWN) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Invalid laser\"}");
+    }
+    if (st.running) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Lock-in already running\"}");
+    }
+
+    if (!IS_ENABLED(CONFIG_APP_LOCKIN)) {
+        return unsupported_response(cmd);
+    }
+    if (args.freq_mhz == 0 || args.freq_mhz > LOCKIN_MAX_FREQ_MHZ ||
+        args.tau_ms < LOCKIN_MIN_TAU_MS) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Improper arguments\"}");
+    }
+
+    power_up_lasers();
+
+    maiman_driver_t driver = { .node_id = laser_id };
+    epoch_begin();
+    bool ok = lockin_modulate(&driver, args.freq_mhz);
+    epoch_bump();
+    if (!ok) {
+        return _msg_builder(cmd, RESP_ERROR, "{\"error\":\"Failed to modulate laser\"}");
+    }
+
+    // Start demodulating only once the light is modulated
+    (void)lockin_start(laser_id, pd_channel_for_laser(laser_id), args.freq_mhz, args.tau_ms);
+    return _msg_builder(cmd, RESP_OK, "{\"status\":\"OK\"}");
+}
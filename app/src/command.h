@@ -22,6 +22,8 @@
 
 enum MsgType { GET, SET, ACK, RESP_OK, RESP_ERROR };
 
+struct coo_mqtt_channel;
+
 struct Command {
 	enum MsgType msg_type;
 
@@ -42,6 +44,8 @@ struct OutMsg {
 	char payload[MAX_PAYLOAD_LEN];
 	uint8_t correlation_data[MAX_CORRELATION_DATA];
 	size_t corr_len;
+	uint32_t queued_at;     // cycle count, set by outbound_put()
+	struct coo_mqtt_channel *channel;  // QoS 0 fixed-topic stream, topic unused
 };
 
 
@@ -57,6 +61,7 @@ struct DispatchEntry {
 	const char   *key;           /* e.g. "memsroute", "laser1/flux", etc. */
 	DispatchFunc get_handler;    // may be none
 	DispatchFunc set_handler;    // may be none
+	uint32_t requires;           /* boot stages (BIT(BOOT_*)) the handlers depend on */
 };
 
 
@@ -78,8 +83,24 @@ struct OutMsg atten_setting_set(const struct Command *cmd);
 
 struct OutMsg status_get(const struct Command *cmd);
 
+struct OutMsg stats_get(const struct Command *cmd);
+
 struct OutMsg sleep_set(const struct Command *cmd);
 
+struct OutMsg photodiode_history_get(const struct Command *cmd);
+struct OutMsg photodiode_stream_get(const struct Command *cmd);
+struct OutMsg photodiode_stream_set(const struct Command *cmd);
+
+struct OutMsg capture_arm_set(const struct Command *cmd);
+struct OutMsg spectrum_set(const struct Command *cmd);
+
+struct OutMsg epoch_get(const struct Command *cmd);
+
+struct OutMsg lockin_get(const struct Command *cmd);
+struct OutMsg lockin_set(const struct Command *cmd);
+
+struct OutMsg not_ready_response(const struct Command *cmd);
+
 
 bool parse_msg_type_from_payload(const char *payload, enum MsgType *msg_type_out);
 struct OutMsg invalid_command_response(const struct Command *cmd);
@@ -89,7 +110,7 @@ struct OutMsg busy_response(const struct Command *cmd);
 struct OutMsg dispatch_command(const struct Command *cmd);
 
 
+extern struct k_mem_slab command_slab;
 extern struct k_msgq inbound_queue;
-extern struct k_msgq outbound_queue;
 
 #endif //COMMAND_H
@@ -11,6 +11,7 @@
 #define __DEVICE_C__
 
 #include "devices.h"
+#include "ads1115.h"
 #include "mems_switching.h"
 LOG_MODULE_REGISTER(devices, LOG_LEVEL_INF);
 
@@ -40,7 +41,6 @@ const struct gpio_dt_spec power_gpio = GPIO_DT_SPEC_GET(USER_NODE, power_gpios);
 
 #define MODBUS_NODE DT_COMPAT_GET_ANY_STATUS_OKAY(zephyr_modbus_serial)
 const char modbus_name[] = DEVICE_DT_NAME(MODBUS_NODE);
-const struct device *adc_dev = DEVICE_DT_GET(DT_NODELABEL(adc1115));
 const struct device *dac_dev = DEVICE_DT_GET(DT_NODELABEL(dac7578)); //or DEVICE_DT_GET_OR_NULL
 const struct device *gpio_dev = DEVICE_DT_GET(DT_NODELABEL(pcal6416a));
 
@@ -270,13 +270,11 @@ bool devices_ready(void)
         }
     }
 
-    if (adc_dev != NULL) {
-        if (!device_is_ready(adc_dev)) {
-            LOG_ERR("Device %s is not ready", adc_dev->name);
-            rc = false;
-        } else {
-            LOG_INF("Device %s is ready", adc_dev->name);
-        }
+    if (!ads1115_ready()) {
+        LOG_ERR("ADS1115 is not responding");
+        rc = false;
+    } else {
+        LOG_INF("ADS1115 bus is ready");
     }
 
     if (gpio_dev != NULL) {
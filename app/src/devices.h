@@ -27,10 +27,11 @@
 #define DAC_RESOLUTION 12
 
 #define NUM_ATTENUATORS 6
+/* Maiman Modbus node IDs run from 1 to 5; per-laser arrays index by node ID */
+#define NUM_LASER_NODES 6
 
 
 // extern const struct device *modbus;
-extern const struct device *adc_dev;
 extern const struct device *dac_dev;
 extern const struct device *gpio_dev;
 
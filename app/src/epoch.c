@@ -0,0 +1,196 @@
+/*
+ * HiSPEC-TIB configuration epochs
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Actuations run on the executor and at boot; samples are tagged from the
+ * photodiode thread. A spinlock covers both, and the snapshot it guards is
+ * a few dozen bytes, so tagging costs the 50 Hz loop next to nothing.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/sys/crc.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "epoch.h"
+#include "maiman.h"
+
+static struct epoch_state ring[CONFIG_APP_EPOCH_HISTORY];
+static uint32_t current;
+/* Nothing is in a known state until boot restores it */
+static bool changing = true;
+static uint8_t laser_on;
+static uint16_t laser_current[NUM_LASER_NODES];
+static struct k_spinlock lock;
+
+void epoch_laser_written(uint8_t node, uint16_t address, uint16_t value)
+{
+    if (node >= NUM_LASER_NODES) {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (address == REG_CURRENT) {
+        laser_current[node] = value;
+    } else if (address == REG_STATE_OF_DEVICE_COMMAND) {
+        if (value == MODBUS_START_COMMAND_VALUE) {
+            laser_on |= BIT(node);
+        } else {
+            laser_on &= ~BIT(node);
+        }
+    }
+    k_spin_unlock(&lock, key);
+}
+
+void epoch_begin(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    changing = true;
+    k_spin_unlock(&lock, key);
+}
+
+void epoch_bump(void)
+{
+    struct epoch_config config = {0};
+
+    config.power = gpio_pin_get_dt(&power_gpio) == 1;
+    for (int i = 0; i < MEMS_ROUTER_MAX_SWITCHES; i++) {
+        config.mems[i] = mems_switches[i].state;
+    }
+    for (int i = 0; i < NUM_ATTENUATORS; i++) {
+        config.atten_mv[i] = (uint16_t)(attenuators[i].voltage * 1000.0 + 0.5);
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    /* Controllers come back stopped after a power cycle */
+    if (!config.power) {
+        laser_on = 0;
+    }
+    config.laser_on = laser_on;
+    memcpy(config.laser_current, laser_current, sizeof(laser_current));
+
+    struct epoch_state *s = &ring[++current % CONFIG_APP_EPOCH_HISTORY];
+
+    s->epoch = current;
+    s->t_ms = k_uptime_get_32();
+    s->digest = crc32_ieee((const uint8_t *)&config, sizeof(config));
+    s->config = config;
+    changing = false;
+    k_spin_unlock(&lock, key);
+}
+
+bool epoch_current(uint32_t *epoch, uint32_t *digest)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    bool stable = !changing;
+
+    *epoch = current;
+    *digest = ring[current % CONFIG_APP_EPOCH_HISTORY].digest;
+    k_spin_unlock(&lock, key);
+
+    return stable;
+}
+
+uint32_t epoch_latest(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t epoch = current;
+
+    k_spin_unlock(&lock, key);
+
+    return epoch;
+}
+
+int epoch_lookup(uint32_t epoch, struct epoch_state *out)
+{
+    int rc = -ENOENT;
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (epoch <= current && current - epoch < CONFIG_APP_EPOCH_HISTORY) {
+        *out = ring[epoch % CONFIG_APP_EPOCH_HISTORY];
+        rc = 0;
+    }
+    k_spin_unlock(&lock, key);
+
+    return rc;
+}
+
+int epoch_format(const struct epoch_state *s, int64_t boot_ms, char *buf, size_t len)
+{
+    const struct epoch_config *c = &s->config;
+    size_t offset;
+    int written;
+
+    written = snprintf(buf, len, "{\"epoch\":%u,\"start\":%lld,\"digest\":\"%08x\","
+                       "\"power\":%s,\"mems\":{", s->epoch, boot_ms + s->t_ms, s->digest,
+                       c->power ? "true" : "false");
+    if (written < 0 || written >= (int)len) {
+        return -ENOMEM;
+    }
+    offset = written;
+
+    for (int i = 0; i < MEMS_ROUTER_MAX_SWITCHES; i++) {
+        written = snprintf(buf + offset, len - offset, "%s\"%s\":\"%c\"", i > 0 ? "," : "",
+                           mems_switches[i].name, c->mems[i] ? c->mems[i] : 'U');
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+
+    written = snprintf(buf + offset, len - offset, "},\"atten_mv\":[");
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    offset += written;
+    for (int i = 0; i < NUM_ATTENUATORS; i++) {
+        written = snprintf(buf + offset, len - offset, "%s%u", i > 0 ? "," : "", c->atten_mv[i]);
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+
+    written = snprintf(buf + offset, len - offset, "],\"laser_on\":[");
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    offset += written;
+    for (int n = 0, first = 1; n < NUM_LASER_NODES; n++) {
+        if (!(c->laser_on & BIT(n))) {
+            continue;
+        }
+        written = snprintf(buf + offset, len - offset, "%s%d", first ? "" : ",", n);
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+        first = 0;
+    }
+
+    /* Node 0 is unused; list nodes 1.. so the index is the node ID - 1 */
+    written = snprintf(buf + offset, len - offset, "],\"laser_current\":[");
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    offset += written;
+    for (int n = 1; n < NUM_LASER_NODES; n++) {
+        written = snprintf(buf + offset, len - offset, "%s%u", n > 1 ? "," : "",
+                           c->laser_current[n]);
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+
+    written = snprintf(buf + offset, len - offset, "]}");
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    return offset + written;
+}
@@ -0,0 +1,87 @@
+/*
+ * HiSPEC-TIB configuration epochs
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <zephyr/kernel.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "devices.h"
+#include "mems_switching.h"
+
+/* Optical configuration; the digest is a CRC-32 over this struct */
+struct epoch_config {
+    uint8_t power;                              /* laser supply on */
+    uint8_t laser_on;                           /* bit n: node n started */
+    char mems[MEMS_ROUTER_MAX_SWITCHES];        /* 'A', 'B' or 'U' */
+    uint16_t atten_mv[NUM_ATTENUATORS];
+    uint16_t laser_current[NUM_LASER_NODES];    /* last REG_CURRENT written, raw */
+} __packed;
+
+struct epoch_state {
+    uint32_t epoch;
+    uint32_t t_ms;      /* k_uptime_get_32() when the epoch began */
+    uint32_t digest;
+    struct epoch_config config;
+};
+
+/*
+ * The configuration epoch counts actuations. Each one is bracketed by
+ * epoch_begin() and epoch_bump(); the bump snapshots the new configuration
+ * as the next epoch. A photodiode sample tagged with epoch N was read
+ * entirely after the actuation that began N was applied (the light may
+ * still be settling) and before the next one began, so the host can look
+ * the configuration up instead of joining command logs against
+ * timestamps. Samples read while an actuation is under way carry no epoch.
+ */
+
+/** Mark an actuation as under way; every path must end in epoch_bump() */
+void epoch_begin(void);
+
+/**
+ * Snapshot the current configuration as a new epoch and end the
+ * actuation. Call once it has taken effect, or failed.
+ */
+void epoch_bump(void);
+
+/**
+ * Record a laser register write for the next snapshot. Only the current
+ * setpoint and start/stop command are kept; other registers are ignored.
+ */
+void epoch_laser_written(uint8_t node, uint16_t address, uint16_t value);
+
+/**
+ * Epoch and digest to tag a sample with. Read once before and once after
+ * the sample; it belongs to the epoch only if both succeed and agree.
+ *
+ * @return false while an actuation is under way
+ */
+bool epoch_current(uint32_t *epoch, uint32_t *digest);
+
+/** Most recent epoch, whether or not an actuation is under way */
+uint32_t epoch_latest(void);
+
+/**
+ * Look up a recent epoch; the last CONFIG_APP_EPOCH_HISTORY are kept.
+ *
+ * @return 0 on success, -ENOENT if @p epoch has aged out or not happened
+ */
+int epoch_lookup(uint32_t epoch, struct epoch_state *out);
+
+/**
+ * Format an epoch as JSON:
+ * {"epoch":7,"start":<epoch ms>,"digest":"1a2b3c4d","power":true,
+ *  "mems":{"<switch>":"A",...},"atten_mv":[...],"laser_on":[1,3],"laser_current":[...]}
+ *
+ * @param boot_ms  Wall-clock time of uptime 0, in epoch ms
+ * @return Number of bytes written (excluding NUL), or negative on overflow
+ */
+int epoch_format(const struct epoch_state *s, int64_t boot_ms, char *buf, size_t len);
+
+#endif //EPOCH_H
@@ -0,0 +1,85 @@
+/*
+ * HiSPEC-TIB photodiode history
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Single writer (the photodiode thread), any number of readers. Readers
+ * copy out in short batches under the spinlock, so the 50 Hz writer is
+ * never held up for longer than one batch.
+ */
+
+#include <zephyr/kernel.h>
+
+#include "history.h"
+
+static struct history_sample ring[HISTORY_LEN];
+static uint32_t head;   /* sequence of the next sample to be written */
+static struct k_spinlock lock;
+
+static inline uint32_t first_seq(void)
+{
+    return head > HISTORY_LEN ? head - HISTORY_LEN : 0;
+}
+
+void history_add(uint32_t t_ms, int16_t yj, int16_t hk, uint8_t yj_range, uint8_t hk_range)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    struct history_sample *s = &ring[head % HISTORY_LEN];
+
+    s->t_ms = t_ms;
+    s->yj = yj;
+    s->hk = hk;
+    s->yj_range = yj_range;
+    s->hk_range = hk_range;
+    head++;
+    k_spin_unlock(&lock, key);
+}
+
+void history_range(uint32_t *first, uint32_t *end)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    *first = first_seq();
+    *end = head;
+    k_spin_unlock(&lock, key);
+}
+
+uint32_t history_find(uint32_t t_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t lo = first_seq();
+    uint32_t hi = head;
+
+    /* Timestamps are monotonic; compare as differences to survive the
+     * 49-day wrap of the 32-bit uptime
+     */
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if ((int32_t)(ring[mid % HISTORY_LEN].t_ms - t_ms) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    k_spin_unlock(&lock, key);
+
+    return lo;
+}
+
+size_t history_copy(uint32_t *seq, uint32_t end, struct history_sample *out, size_t max)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t s = MAX(*seq, first_seq());
+    size_t n = 0;
+
+    end = MIN(end, head);
+    while (n < max && s < end) {
+        out[n++] = ring[s % HISTORY_LEN];
+        s++;
+    }
+    k_spin_unlock(&lock, key);
+
+    *seq = s;
+    return n;
+}
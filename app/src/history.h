@@ -0,0 +1,61 @@
+/*
+ * HiSPEC-TIB photodiode history
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <zephyr/kernel.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Photodiode sample and publish period; the history keeps every sample */
+#define PUBLISH_INTERVAL_MS 20
+
+#define HISTORY_LEN (CONFIG_APP_PHOTODIODE_HISTORY_S * 1000 / PUBLISH_INTERVAL_MS)
+
+/*
+ * One photodiode sample in raw counts of the range it was read on (an
+ * auto-ranging ladder index); INT16_MIN marks a failed read. Packed to
+ * 9 bytes, as the ring holds every sample.
+ */
+struct history_sample {
+    uint32_t t_ms;  /* k_uptime_get_32() */
+    int16_t yj;
+    int16_t hk;
+    uint8_t yj_range : 4;
+    uint8_t hk_range : 4;
+} __packed;
+
+/*
+ * The last CONFIG_APP_PHOTODIODE_HISTORY_S seconds of samples, kept in a
+ * RAM ring. Every sample ever added has a sequence number; a sequence is
+ * readable until the ring wraps over it.
+ */
+
+/** Append a sample, overwriting the oldest once the ring is full */
+void history_add(uint32_t t_ms, int16_t yj, int16_t hk, uint8_t yj_range, uint8_t hk_range);
+
+/**
+ * Sequence range currently held: [*first, *end). Empty when equal.
+ */
+void history_range(uint32_t *first, uint32_t *end);
+
+/**
+ * First sequence held whose timestamp is at or after @p t_ms, or the end
+ * of the range if none.
+ */
+uint32_t history_find(uint32_t t_ms);
+
+/**
+ * Copy up to @p max samples from sequence @p seq up to, not including,
+ * @p end. Samples the ring has already overwritten are skipped.
+ *
+ * @param seq  In: first sequence wanted. Out: sequence after the last copied.
+ * @return Number of samples copied
+ */
+size_t history_copy(uint32_t *seq, uint32_t end, struct history_sample *out, size_t max);
+
+#endif //HISTORY_H
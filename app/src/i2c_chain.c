@@ -0,0 +1,89 @@
+/*
+ * HiSPEC-TIB chained I2C transfers over RTIO
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "i2c_chain.h"
+
+bool i2c_chain_ready(const struct i2c_chain *chain)
+{
+    /* I2C_DT_IODEV_DEFINE hangs the device's spec off the iodev */
+    const struct i2c_dt_spec *spec = chain->iodev->data;
+
+    return i2c_is_ready_dt(spec);
+}
+
+int i2c_chain_write(const struct i2c_chain *chain, const uint8_t *buf, uint8_t len, bool more)
+{
+    struct rtio_sqe *wr = rtio_sqe_acquire(chain->ctx);
+
+    if (wr == NULL) {
+        return -ENOMEM;
+    }
+
+    rtio_sqe_prep_tiny_write(wr, chain->iodev, RTIO_PRIO_NORM, buf, len, NULL);
+    wr->iodev_flags |= RTIO_IODEV_I2C_STOP;
+    if (more) {
+        wr->flags |= RTIO_SQE_CHAINED;
+    }
+    return 0;
+}
+
+int i2c_chain_delay(const struct i2c_chain *chain, k_timeout_t delay, bool more)
+{
+    struct rtio_sqe *wait = rtio_sqe_acquire(chain->ctx);
+
+    if (wait == NULL) {
+        return -ENOMEM;
+    }
+
+    rtio_sqe_prep_delay(wait, delay, NULL);
+    if (more) {
+        wait->flags |= RTIO_SQE_CHAINED;
+    }
+    return 0;
+}
+
+int i2c_chain_reg_read(const struct i2c_chain *chain, uint8_t reg, uint8_t *buf, size_t len,
+                       bool more)
+{
+    struct rtio_sqe *ptr = rtio_sqe_acquire(chain->ctx);
+    struct rtio_sqe *rd = rtio_sqe_acquire(chain->ctx);
+
+    if (ptr == NULL || rd == NULL) {
+        return -ENOMEM;
+    }
+
+    rtio_sqe_prep_tiny_write(ptr, chain->iodev, RTIO_PRIO_NORM, &reg, 1, NULL);
+    ptr->flags |= RTIO_SQE_TRANSACTION;
+    rtio_sqe_prep_read(rd, chain->iodev, RTIO_PRIO_NORM, buf, len, NULL);
+    rd->iodev_flags |= RTIO_IODEV_I2C_STOP | RTIO_IODEV_I2C_RESTART;
+    if (more) {
+        rd->flags |= RTIO_SQE_CHAINED;
+    }
+    return 0;
+}
+
+int i2c_chain_run(const struct i2c_chain *chain, size_t count)
+{
+    int rc = rtio_submit(chain->ctx, count);
+
+    for (size_t i = 0; i < count; i++) {
+        struct rtio_cqe *cqe = rtio_cqe_consume(chain->ctx);
+
+        if (cqe == NULL) {
+            break;
+        }
+        if (cqe->result < 0 && rc == 0) {
+            rc = cqe->result;
+        }
+        rtio_cqe_release(chain->ctx, cqe);
+    }
+    return rc;
+}
+
+void i2c_chain_cancel(const struct i2c_chain *chain)
+{
+    rtio_sqe_drop_all(chain->ctx);
+}
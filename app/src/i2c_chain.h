@@ -0,0 +1,72 @@
+/*
+ * HiSPEC-TIB chained I2C transfers over RTIO
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * A submission queue bound to one I2C device. Callers queue writes,
+ * delays and register reads, then run them as one submission: the bus
+ * driver steps through the chain and the caller blocks once, until the
+ * last entry completes. Nothing here is asynchronous to the caller.
+ */
+
+#ifndef I2C_CHAIN_H
+#define I2C_CHAIN_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/rtio/rtio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Entries one i2c_chain_reg_read() queues */
+#define I2C_CHAIN_REG_READ_SQES 2
+
+struct i2c_chain {
+    struct rtio *ctx;
+    struct rtio_iodev *iodev;
+};
+
+/**
+ * Define chain @p name for devicetree node @p node_id, with room for
+ * @p entries queued entries. Not reentrant; callers serialize.
+ */
+#define I2C_CHAIN_DEFINE(name, node_id, entries)                        \
+    I2C_DT_IODEV_DEFINE(name##_iodev, node_id);                         \
+    RTIO_DEFINE(name##_rtio, entries, entries);                         \
+    static const struct i2c_chain name = {                              \
+        .ctx = &name##_rtio,                                            \
+        .iodev = &name##_iodev,                                         \
+    }
+
+/** True once the chain's I2C bus is ready */
+bool i2c_chain_ready(const struct i2c_chain *chain);
+
+/**
+ * Queue a write of @p len bytes (at most 7, copied) ending in a STOP.
+ * @p more chains the next entry after it.
+ */
+int i2c_chain_write(const struct i2c_chain *chain, const uint8_t *buf, uint8_t len, bool more);
+
+/** Queue a wait of @p delay, chained to the next entry if @p more */
+int i2c_chain_delay(const struct i2c_chain *chain, k_timeout_t delay, bool more);
+
+/**
+ * Queue a register pointer write and a read of @p len bytes into @p buf
+ * as one transaction, chained to the next entry if @p more.
+ */
+int i2c_chain_reg_read(const struct i2c_chain *chain, uint8_t reg, uint8_t *buf, size_t len,
+                       bool more);
+
+/**
+ * Submit the @p count entries queued since the last run and wait for
+ * them all. Entries after a failed one in the chain are cancelled.
+ *
+ * @return 0 or the first error
+ */
+int i2c_chain_run(const struct i2c_chain *chain, size_t count);
+
+/** Drop entries queued but not run, after a failure to queue the rest */
+void i2c_chain_cancel(const struct i2c_chain *chain);
+
+#endif //I2C_CHAIN_H
@@ -0,0 +1,203 @@
+/*
+ * HiSPEC-TIB photodiode lock-in detection
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * The executor starts and stops; the photodiode thread does everything
+ * else. Settings and results cross under a spinlock, the filter state is
+ * the photodiode thread's alone.
+ *
+ * The reference phase is kept as a cycle count modulo the period, so it
+ * never accumulates rounding error however long the lock-in runs.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "lockin.h"
+#include "epoch.h"
+#include "outbound.h"
+
+LOG_MODULE_REGISTER(lockin, CONFIG_APP_LOG_LEVEL);
+
+/* Results count as settled after this many time constants */
+#define LOCKIN_SETTLE_TAUS   5
+
+static struct k_spinlock lock;
+static struct lockin_status status;
+static bool restart;
+
+/* Photodiode thread only */
+static uint64_t period_cyc;
+static uint64_t phase_cyc;
+static uint32_t last_cyc;
+static float tau_s;
+static float i_lp, q_lp, dc_lp;
+static bool primed;
+static int64_t start_ms;
+static int64_t next_publish_ms;
+static struct OutMsg msg;
+
+int lockin_start(uint8_t node, enum pd_channel ch, uint32_t freq_mhz, uint32_t tau_ms)
+{
+    if (freq_mhz == 0 || freq_mhz > LOCKIN_MAX_FREQ_MHZ || tau_ms < LOCKIN_MIN_TAU_MS ||
+        ch >= PD_CHANNEL_COUNT) {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    status = (struct lockin_status){
+        .running = true,
+        .node = node,
+        .channel = ch,
+        .freq_mhz = freq_mhz,
+        .tau_ms = tau_ms,
+    };
+    restart = true;
+    k_spin_unlock(&lock, key);
+
+    LOG_INF("Lock-in on node %d at %u mHz, tau %u ms", node, freq_mhz, tau_ms);
+    return 0;
+}
+
+void lockin_stop(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    status.running = false;
+    k_spin_unlock(&lock, key);
+}
+
+void lockin_get_status(struct lockin_status *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    *out = status;
+    k_spin_unlock(&lock, key);
+}
+
+bool lockin_channel(enum pd_channel *ch)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    bool running = status.running;
+
+    *ch = status.channel;
+    k_spin_unlock(&lock, key);
+
+    return running;
+}
+
+static void reset_filter(uint32_t freq_mhz, uint32_t tau_ms)
+{
+    period_cyc = (uint64_t)sys_clock_hw_cycles_per_sec() * 1000U / freq_mhz;
+    phase_cyc = 0;
+    tau_s = tau_ms / 1000.0f;
+    i_lp = q_lp = dc_lp = 0.0f;
+    primed = false;
+    start_ms = k_uptime_get();
+    next_publish_ms = start_ms + CONFIG_APP_LOCKIN_PUBLISH_MS;
+}
+
+static void demodulate(int16_t sample, uint32_t now_cyc)
+{
+    float x = sample;
+
+    if (!primed) {
+        /* Start the DC estimate at the signal, not at zero */
+        dc_lp = x;
+        last_cyc = now_cyc;
+        primed = true;
+        return;
+    }
+
+    uint32_t dt_cyc = now_cyc - last_cyc;
+    float dt_s = (float)dt_cyc / sys_clock_hw_cycles_per_sec();
+    float alpha = 1.0f - expf(-dt_s / tau_s);
+    float phi;
+
+    last_cyc = now_cyc;
+    phase_cyc = (phase_cyc + dt_cyc) % period_cyc;
+    phi = 2.0f * (float)M_PI * (float)phase_cyc / (float)period_cyc;
+
+    /* Mix with the DC removed so it cannot leak through the low-pass */
+    dc_lp += alpha * (x - dc_lp);
+    x -= dc_lp;
+    i_lp += alpha * (x * cosf(phi) - i_lp);
+    q_lp += alpha * (x * sinf(phi) - q_lp);
+}
+
+static void publish(const struct lockin_status *s)
+{
+    struct timespec ts;
+    uint32_t epoch, digest;
+    char epoch_str[12] = "null";
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if (epoch_current(&epoch, &digest)) {
+        snprintf(epoch_str, sizeof(epoch_str), "%u", epoch);
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    strncpy(msg.topic, LOCKIN_TOPIC, sizeof(msg.topic) - 1);
+    msg.qos = 0;
+    msg.payload_len = snprintf(msg.payload, sizeof(msg.payload),
+                               "{\"node\":%u,\"ch\":\"%s\",\"freq_mhz\":%u,\"tau_ms\":%u,"
+                               "\"amplitude\":%.2f,\"phase_deg\":%.1f,\"dc\":%.1f,"
+                               "\"fsr_mv\":%u,\"n\":%u,\"settled\":%s,\"time\":%lld,\"epoch\":%s}",
+                               s->node, s->channel == PD_HK ? "hk" : "yj", s->freq_mhz,
+                               s->tau_ms, (double)s->amplitude, (double)s->phase_deg,
+                               (double)s->dc, photodiode_fsr_mv(s->channel), s->samples,
+                               s->run_ms >= LOCKIN_SETTLE_TAUS * s->tau_ms ? "true" : "false",
+                               ts.tv_sec, epoch_str);
+
+    outbound_put(OUT_TELEMETRY, &msg, K_NO_WAIT);
+}
+
+int16_t lockin_run(enum pd_channel ch, int64_t until_ms)
+{
+    struct lockin_status snap;
+    int32_t sum = 0;
+    uint32_t n = 0;
+    int16_t sample;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (restart) {
+        reset_filter(status.freq_mhz, status.tau_ms);
+        restart = false;
+    }
+    k_spin_unlock(&lock, key);
+
+    while (k_uptime_get() < until_ms) {
+        if (photodiode_read_channel(ch, true, &sample) != 0) {
+            break;
+        }
+        demodulate(sample, k_cycle_get_32());
+        sum += sample;
+        n++;
+    }
+
+    /* Fundamental of x = A cos(phi - theta): I = A/2 cos(theta), Q = A/2 sin(theta) */
+    key = k_spin_lock(&lock);
+    if (status.running && !restart) {
+        status.samples += n;
+        status.run_ms = (uint32_t)(k_uptime_get() - start_ms);
+        status.amplitude = 2.0f * sqrtf(i_lp * i_lp + q_lp * q_lp);
+        status.phase_deg = atan2f(q_lp, i_lp) * (180.0f / (float)M_PI);
+        status.dc = dc_lp;
+    }
+    snap = status;
+    k_spin_unlock(&lock, key);
+
+    if (snap.running && k_uptime_get() >= next_publish_ms) {
+        next_publish_ms += CONFIG_APP_LOCKIN_PUBLISH_MS;
+        publish(&snap);
+    }
+
+    return n > 0 ? (int16_t)(sum / (int32_t)n) : INT16_MIN;
+}
@@ -0,0 +1,104 @@
+/*
+ * HiSPEC-TIB photodiode lock-in detection
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LOCKIN_H
+#define LOCKIN_H
+
+#include <zephyr/kernel.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "photodiode.h"
+
+#define LOCKIN_TOPIC "dt/hsfib-tib/lockin"
+
+/* The Maiman frequency register tops out at 65.535 Hz, well under the
+ * Nyquist limit of 860 SPS reads; the filter must span many samples
+ */
+#define LOCKIN_MAX_FREQ_MHZ  65535
+#define LOCKIN_MIN_TAU_MS    50
+
+struct lockin_status {
+    bool running;
+    uint8_t node;           /* Modbus node of the modulated laser */
+    uint8_t channel;        /* enum pd_channel */
+    uint32_t freq_mhz;      /* reference frequency (mHz) */
+    uint32_t tau_ms;        /* low-pass time constant */
+    uint32_t samples;       /* demodulated since the start */
+    uint32_t run_ms;        /* time since the start */
+    float amplitude;        /* counts, peak of the fundamental */
+    float phase_deg;
+    float dc;               /* counts */
+};
+
+/*
+ * While running, the photodiode loop spends each 20 ms interval reading
+ * the lock-in channel at 860 SPS and mixing every sample with a reference
+ * at freq_mhz, timed from the cycle counter. I and Q pass through a
+ * first-order low-pass of time constant tau_ms; amplitude and phase are
+ * published on LOCKIN_TOPIC every CONFIG_APP_LOCKIN_PUBLISH_MS.
+ *
+ * The laser's pulse generator runs from its own clock, so the phase walks
+ * at the frequency error between the two. The amplitude is unaffected as
+ * long as that walk is slow next to tau_ms.
+ */
+
+#if defined(CONFIG_APP_LOCKIN)
+
+/**
+ * Start demodulating @p ch. Configuring the laser is up to the caller.
+ *
+ * @return 0 on success, -EINVAL for a frequency or time constant the
+ *         sample rate cannot support
+ */
+int lockin_start(uint8_t node, enum pd_channel ch, uint32_t freq_mhz, uint32_t tau_ms);
+
+/** Stop demodulating; the last result stays readable */
+void lockin_stop(void);
+
+void lockin_get_status(struct lockin_status *out);
+
+/* Photodiode thread: the channel to demodulate, if running */
+bool lockin_channel(enum pd_channel *ch);
+
+/**
+ * Photodiode thread: read and demodulate @p ch until @p until_ms of
+ * uptime, publishing when due.
+ *
+ * @return Mean of the samples read, for the history, or INT16_MIN if none
+ */
+int16_t lockin_run(enum pd_channel ch, int64_t until_ms);
+
+#else
+
+static inline int lockin_start(uint8_t node, enum pd_channel ch, uint32_t freq_mhz,
+                               uint32_t tau_ms)
+{
+    return -ENOTSUP;
+}
+
+static inline void lockin_stop(void)
+{
+}
+
+static inline void lockin_get_status(struct lockin_status *out)
+{
+    *out = (struct lockin_status){0};
+}
+
+static inline bool lockin_channel(enum pd_channel *ch)
+{
+    return false;
+}
+
+static inline int16_t lockin_run(enum pd_channel ch, int64_t until_ms)
+{
+    return INT16_MIN;
+}
+
+#endif
+
+#endif //LOCKIN_H
@@ -0,0 +1,150 @@
+/*
+ * HiSPEC-TIB MQTT log backend
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Collects formatted log lines into a batch and hands the batch to the
+ * outbound queue from the system work queue, so nothing here ever blocks
+ * the log processing thread on the network.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log_backend.h>
+#include <zephyr/logging/log_ctrl.h>
+#include <zephyr/logging/log_output.h>
+#include <string.h>
+
+#include "command.h"
+#include "outbound.h"
+
+#define LOG_MQTT_TOPIC "dt/hsfib-tib/log"
+
+/* Leave room for the "+N dropped" trailer */
+#define LOG_MQTT_BATCH_LEN (MAX_PAYLOAD_LEN - 24)
+
+static struct k_spinlock batch_lock;
+static char batch[LOG_MQTT_BATCH_LEN];
+static size_t batch_len;
+static uint32_t batch_dropped;
+
+static struct k_work_delayable flush_work;
+static bool backend_ready;
+
+static uint8_t line_buf[128];
+static char line[LOG_MQTT_BATCH_LEN];
+static size_t line_len;
+
+static int line_out(uint8_t *data, size_t length, void *ctx)
+{
+    ARG_UNUSED(ctx);
+
+    size_t n = MIN(length, sizeof(line) - line_len);
+
+    memcpy(&line[line_len], data, n);
+    line_len += n;
+
+    /* Report everything as consumed; overlong lines are truncated */
+    return length;
+}
+
+LOG_OUTPUT_DEFINE(log_output_mqtt, line_out, line_buf, sizeof(line_buf));
+
+static void flush_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    struct OutMsg msg = {0};
+    k_spinlock_key_t key = k_spin_lock(&batch_lock);
+
+    if (batch_len == 0 && batch_dropped == 0) {
+        k_spin_unlock(&batch_lock, key);
+        return;
+    }
+
+    memcpy(msg.payload, batch, batch_len);
+    msg.payload_len = batch_len;
+    if (batch_dropped > 0) {
+        msg.payload_len += snprintk(&msg.payload[batch_len], sizeof(msg.payload) - batch_len,
+                                    "+%u dropped\n", batch_dropped);
+    }
+    batch_len = 0;
+    batch_dropped = 0;
+
+    k_spin_unlock(&batch_lock, key);
+
+    msg.msg_type = RESP_OK;
+    msg.qos = MQTT_QOS_0_AT_MOST_ONCE;
+    strncpy(msg.topic, LOG_MQTT_TOPIC, sizeof(msg.topic) - 1);
+
+    /* Never log from here: a full queue would only feed more log lines back in */
+    (void)outbound_put(OUT_METRICS, &msg, K_NO_WAIT);
+}
+
+static void process(const struct log_backend *const backend, union log_msg_generic *msg)
+{
+    ARG_UNUSED(backend);
+
+    if (log_msg_get_level(&msg->log) > CONFIG_APP_LOG_BACKEND_MQTT_LEVEL) {
+        return;
+    }
+
+    /* Called from the log thread only, so the line buffer needs no lock */
+    line_len = 0;
+    log_output_msg_process(&log_output_mqtt, &msg->log,
+                           LOG_OUTPUT_FLAG_LEVEL | LOG_OUTPUT_FLAG_TIMESTAMP);
+    log_output_flush(&log_output_mqtt);
+
+    k_spinlock_key_t key = k_spin_lock(&batch_lock);
+    bool full = false;
+
+    if (batch_len + line_len <= sizeof(batch)) {
+        memcpy(&batch[batch_len], line, line_len);
+        batch_len += line_len;
+        full = sizeof(batch) - batch_len < sizeof(line_buf);
+    } else {
+        batch_dropped++;
+        full = true;
+    }
+
+    k_spin_unlock(&batch_lock, key);
+
+    if (backend_ready && full) {
+        k_work_reschedule(&flush_work, K_NO_WAIT);
+    } else if (backend_ready) {
+        /* Start the batch window on the first line; later lines join it */
+        k_work_schedule(&flush_work, K_MSEC(CONFIG_APP_LOG_BACKEND_MQTT_FLUSH_MS));
+    }
+}
+
+static void dropped(const struct log_backend *const backend, uint32_t cnt)
+{
+    ARG_UNUSED(backend);
+
+    k_spinlock_key_t key = k_spin_lock(&batch_lock);
+
+    batch_dropped += cnt;
+    k_spin_unlock(&batch_lock, key);
+}
+
+static void panic(const struct log_backend *const backend)
+{
+    /* The network path is not usable after a panic */
+    log_backend_disable(backend);
+}
+
+static void init(const struct log_backend *const backend)
+{
+    ARG_UNUSED(backend);
+
+    k_work_init_delayable(&flush_work, flush_handler);
+    backend_ready = true;
+}
+
+static const struct log_backend_api log_backend_mqtt_api = {
+    .process = process,
+    .dropped = dropped,
+    .panic = panic,
+    .init = init,
+};
+
+LOG_BACKEND_DEFINE(log_backend_mqtt, log_backend_mqtt_api, true);
@@ -0,0 +1,43 @@
+/*
+ * HiSPEC-TIB rate-limited logging
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LOG_RATELIMIT_H
+#define LOG_RATELIMIT_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+
+/**
+ * Log a warning at most once per CONFIG_APP_LOG_RATELIMIT_MS from this call
+ * site. Occurrences in between are counted and reported with the next
+ * message that gets through. Use for warnings that can repeat at loop rate
+ * (queue full, ADC overrun).
+ */
+#define TIB_LOG_WRN_RATELIMIT(fmt, ...)                                             \
+    do {                                                                            \
+        static int64_t _rl_last;                                                    \
+        static bool _rl_armed;                                                      \
+        static atomic_t _rl_suppressed;                                             \
+        int64_t _rl_now = k_uptime_get();                                           \
+                                                                                    \
+        if (!_rl_armed || CONFIG_APP_LOG_RATELIMIT_MS == 0 ||                       \
+            _rl_now - _rl_last >= CONFIG_APP_LOG_RATELIMIT_MS) {                    \
+            atomic_val_t _rl_n = atomic_clear(&_rl_suppressed);                     \
+                                                                                    \
+            _rl_armed = true;                                                       \
+            _rl_last = _rl_now;                                                     \
+            if (_rl_n > 0) {                                                        \
+                LOG_WRN(fmt " (+%ld suppressed)", ##__VA_ARGS__, (long)_rl_n);      \
+            } else {                                                                \
+                LOG_WRN(fmt, ##__VA_ARGS__);                                        \
+            }                                                                       \
+        } else {                                                                    \
+            atomic_inc(&_rl_suppressed);                                            \
+        }                                                                           \
+    } while (0)
+
+#endif //LOG_RATELIMIT_H
@@ -3,6 +3,7 @@
 //
 
 #include "maiman.h"
+#include "metrics.h"
 #include <zephyr/logging/log.h>
 #include <ctype.h>
 
@@ -48,6 +49,7 @@ bool maiman_read_u16(maiman_driver_t *drv, uint16_t address, uint16_t *value) {
                                        value,
                                        1);
     if (err < 0) {
+        metrics_inc(METRICS_MODBUS_ERROR);
         LOG_ERR("Modbus read failed: %d", err);
         return false;
     }
@@ -61,6 +63,7 @@ bool maiman_write_u16(maiman_driver_t *drv, uint16_t address, uint16_t value) {
                                         &value,
                                         1);
     if (err < 0) {
+        metrics_inc(METRICS_MODBUS_ERROR);
         LOG_ERR("Modbus write failed: %d", err);
         return false;
     }
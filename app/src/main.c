@@ -9,7 +9,6 @@ LOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
 
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
-#include <zephyr/drivers/watchdog.h>
 #include <zephyr/net/socket.h>
 #include <zephyr/settings/settings.h>
 #include <zephyr/net/mqtt.h>
@@ -26,11 +25,15 @@ LOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
 #include "devices.h"
 #include "command.h"
 #include "photodiode.h"
+#include "metrics.h"
+#include "outbound.h"
+#include "log_ratelimit.h"
+#include "supervisor.h"
+#include "boot.h"
 
 /* Overall TODOs
 TODO: Incorporate UUID generation: https://github.com/zephyrproject-rtos/zephyr/tree/main/samples/subsys/uuid
 TODO: Verify how I'm doing logging makes sense: https://github.com/zephyrproject-rtos/zephyr/tree/main/samples/subsys/logging/logger
-TODO: Incorporate settings persistance: https://github.com/zephyrproject-rtos/zephyr/blob/main/samples/subsys/settings/src/main.c#L392
 TODO: Veryfy I'm dealing with networking properly and setup DHCP with fallback to static. see https://github.com/zephyrproject-rtos/zephyr/tree/main/samples/net/common
 */
 
@@ -47,33 +50,15 @@ TODO: Veryfy I'm dealing with networking properly and setup DHCP with fallback t
 #define MQTT_CMD_PREFIX "cmd/hsfib-tib/req/"
 
 /* Thread stack sizes and priorities */
-#define EXECUTOR_STACK_SIZE 1024
+/* A command holds several ~620 B OutMsg/payload buffers at once (dispatch
+ * return, handler payload, _msg_builder result) plus handler locals such
+ * as the attenuator calibration fit; check with stats "threads"
+ */
+#define EXECUTOR_STACK_SIZE 4096
 #define EXECUTOR_PRIORITY   5
-#define PHOTODIODE_STACK_SIZE 500
-#define PHOTODIODE_PRIORITY 5
-
-/* Watchdog configuration */
-#define WDT_FEED_INTERVAL_MS 1000
-#define WDT_TIMEOUT_MS       5000
-
-/* Settings Management - Stub for future use */
-static int setting_handler(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
-{
-	if (strcmp(name, "foo") == 0 && len == sizeof(uint8_t)) {
-		uint8_t val;
-		if (read_cb(cb_arg, &val, sizeof(val)) == sizeof(val)) {
-			printk("Restored foo = %d\n", val);
-			// store to your config struct
-		}
-	}
-	return 0;
-}
-
-SETTINGS_STATIC_HANDLER_DEFINE(myapp, "tib",
-	NULL, //get
-	setting_handler, //set
-	NULL, //commit
-	NULL); //export
+#define PHOTODIODE_STACK_SIZE 2048
+/* Above the executor, so command handling cannot delay a sample */
+#define PHOTODIODE_PRIORITY 4
 
 /* MQTT Infrastructure */
 static struct mqtt_client client_ctx;
@@ -82,167 +67,160 @@ static struct mqtt_client client_ctx;
 static K_THREAD_STACK_DEFINE(exec_stack, EXECUTOR_STACK_SIZE);
 static struct k_thread exec_thread_data;
 
-/* Photodiode work */
-static struct k_work_delayable photodiode_publish_work;
-
 /* Photodiode thread */
 K_THREAD_DEFINE(photodiode_tid, PHOTODIODE_STACK_SIZE,
                 photodiode_thread, NULL, NULL, NULL,
                 PHOTODIODE_PRIORITY, 0, 0);
 
-/* Watchdog callback (optional - for notification before reset) */
-static void wdt_callback(const struct device *wdt_dev, int channel_id)
-{
-	LOG_ERR("Watchdog callback triggered - system will reset!");
-}
-
-/* Initialize watchdog */
-static int watchdog_init(const struct device **wdt_out, int *wdt_channel_out)
+/* Idle hook: the MQTT loop is alive between blocking steps */
+static void mqtt_checkin(void)
 {
-	const struct device *wdt;
-	int wdt_channel_id;
-	struct wdt_timeout_cfg wdt_config;
-
-	wdt = DEVICE_DT_GET_OR_NULL(DT_ALIAS(watchdog0));
-	if (!wdt || !device_is_ready(wdt)) {
-		LOG_WRN("Watchdog device not available - continuing without watchdog");
-		*wdt_out = NULL;
-		return -ENODEV;
-	}
-
-	/* Configure watchdog */
-	wdt_config.flags = WDT_FLAG_RESET_SOC;
-	wdt_config.window.min = 0U;
-	wdt_config.window.max = WDT_TIMEOUT_MS;
-	wdt_config.callback = wdt_callback;
-
-	wdt_channel_id = wdt_install_timeout(wdt, &wdt_config);
-	if (wdt_channel_id < 0) {
-		LOG_ERR("Failed to install watchdog timeout (%d)", wdt_channel_id);
-		return wdt_channel_id;
-	}
-
-	if (wdt_setup(wdt, WDT_OPT_PAUSE_HALTED_BY_DBG) < 0) {
-		LOG_ERR("Failed to setup watchdog");
-		return -EIO;
-	}
-
-	LOG_INF("Watchdog initialized (timeout: %d ms)", WDT_TIMEOUT_MS);
-
-	*wdt_out = wdt;
-	*wdt_channel_out = wdt_channel_id;
-	return 0;
-}
-
-void log_mac_addr(struct net_if *iface)
-{
-	struct net_linkaddr *mac;
-
-	mac = net_if_get_link_addr(iface);
-
-	LOG_INF("MAC Address: %02X:%02X:%02X:%02X:%02X:%02X",
-		mac->addr[0], mac->addr[1], mac->addr[2],
-		mac->addr[3], mac->addr[4], mac->addr[5]);
+	supervisor_checkin(SUPERVISOR_MQTT);
 }
 
 void executor_thread_fn(void *p1, void *p2, void *p3)
 {
 	ARG_UNUSED(p1); ARG_UNUSED(p2); ARG_UNUSED(p3);
 
-	struct Command cmd;
-	struct OutMsg om;
+	struct Command *cmd;
+	/* Only this thread uses it; keeps one OutMsg off the stack */
+	static struct OutMsg om;
+	/* Wake up often enough to check in while idle or blocked on a full queue */
+	const k_timeout_t checkin = K_MSEC(CONFIG_APP_SUPERVISOR_EXECUTOR_DEADLINE_MS / 2);
+
+	supervisor_register(SUPERVISOR_EXECUTOR);
 
 	while (1) {
+		supervisor_checkin(SUPERVISOR_EXECUTOR);
+
 		/* wait for next command */
-		k_msgq_get(&inbound_queue, &cmd, K_FOREVER);
+		if (k_msgq_get(&inbound_queue, &cmd, checkin) != 0) {
+			continue;
+		}
 
 		/* perform dispatch, get back JSON result string */
-		om = dispatch_command(&cmd);
-
-		/* enqueue for MQTT publish */
-		if (k_msgq_put(&outbound_queue, &om, K_FOREVER) != 0) {
-			LOG_WRN("Outbound queue full; dropping response");
+		om = dispatch_command(cmd);
+		k_mem_slab_free(&command_slab, cmd);
+		supervisor_checkin(SUPERVISOR_EXECUTOR);
+
+		/* enqueue for MQTT publish; during a broker outage this waits for
+		 * the main loop to drain the queue after the reconnect
+		 */
+		while (outbound_put(OUT_RESPONSE, &om, checkin) != 0) {
+			TIB_LOG_WRN_RATELIMIT("Response queue full; waiting to publish");
+			supervisor_checkin(SUPERVISOR_EXECUTOR);
 		}
 	}
 }
 
-static void photodiode_publish_handler(struct k_work *work) {
-	struct OutMsg r;
+/* Rejections are built here rather than on the MQTT thread's stack */
+static struct Command reject_cmd;
+static struct OutMsg reject_msg;
 
-	while (k_msgq_get(&photodiode_queue, &r, K_NO_WAIT) == 0) {
-		if (k_msgq_put(&outbound_queue, &r, K_NO_WAIT) != 0) {
-			LOG_WRN("Outbound queue full, dropping sample");
-		}
-	}
-
-	// Re-schedule
-	k_work_schedule(&photodiode_publish_work, K_MSEC(10)); // 100 Hz (production rate is 50Hz)
+static void reject_command(struct OutMsg (*builder)(const struct Command *),
+			   const struct Command *cmd)
+{
+	reject_msg = builder(cmd);
+	outbound_put(OUT_RESPONSE, &reject_msg, K_NO_WAIT);
 }
 
-static void mqtt_command_handler(const struct mqtt_publish_param *pub)
+/* Runs on the MQTT thread before the payload is read: the payload goes
+ * straight from the socket into a command slot, which is then handed to
+ * the executor by pointer.
+ */
+static void mqtt_command_handler(struct mqtt_client *client, const struct mqtt_publish_param *pub)
 {
-	struct Command cmd = { 0 };
+	const struct mqtt_utf8 *topic = &pub->message.topic.topic;
+	struct Command *cmd;
+	bool busy = false;
 
 	/* Must start with our prefix */
 	size_t prefix_len = strlen(MQTT_CMD_PREFIX);
-	if (strncmp(pub->message.topic.topic.utf8, MQTT_CMD_PREFIX, prefix_len) != 0) {
+	if (topic->size < prefix_len || strncmp((const char *)topic->utf8, MQTT_CMD_PREFIX, prefix_len) != 0) {
 		LOG_WRN("Shouldn't even be getting these messages");
 		return;
 	}
 
+	if (k_mem_slab_alloc(&command_slab, (void **)&cmd, K_NO_WAIT) != 0) {
+		/* Executor busy: keep just enough to address the NACK */
+		cmd = &reject_cmd;
+		busy = true;
+	}
+	memset(cmd, 0, offsetof(struct Command, payload));
+	cmd->corr_len = 0;
+
+    /* Response topic and correlation data first, so every NACK can be routed */
+	if (pub->prop.response_topic.utf8 && pub->prop.response_topic.size < sizeof(cmd->response_topic)) {
+		memcpy(cmd->response_topic,
+			   pub->prop.response_topic.utf8,
+			   pub->prop.response_topic.size);
+		cmd->response_topic[pub->prop.response_topic.size] = '\0';
+	}
+
+    /* Save the broker's correlation_data so we can echo it back */
+    if (pub->prop.correlation_data.len > 0 &&
+        pub->prop.correlation_data.len < sizeof(cmd->correlation_data)) {
+        memcpy(cmd->correlation_data,
+               pub->prop.correlation_data.data,
+               pub->prop.correlation_data.len);
+        cmd->corr_len = pub->prop.correlation_data.len;
+    }
+
     /* 1) cmd.key ← everything after "cmd/hsfib-tib/req/" */
-    const char *suffix = pub->message.topic.topic.utf8 + prefix_len;
-    size_t suffix_len = strlen(suffix);
+    size_t suffix_len = topic->size - prefix_len;
     if (suffix_len == 0 || suffix_len >= MAX_KEY_LEN) {
     	LOG_WRN("Topic too long, dropping command");
-    	struct OutMsg r = invalid_command_response(&cmd);
-    	k_msgq_put(&outbound_queue, &r, K_NO_WAIT);
-        return;
+    	reject_command(invalid_command_response, cmd);
+        goto release;
     }
+    memcpy(cmd->key, topic->utf8 + prefix_len, suffix_len);
+    cmd->key[suffix_len] = '\0';
+
+	if (busy) {
+		TIB_LOG_WRN_RATELIMIT("Executor busy; rejecting cmd=%s", cmd->key);
+		metrics_inc(METRICS_CMD_BUSY);
+		metrics_queue_drop(METRICS_Q_INBOUND, 1);
+		reject_command(busy_response, cmd);
+		return;
+	}
 
-    memcpy(cmd.key, suffix, suffix_len);
-    cmd.key[suffix_len] = '\0';
-
-    /* 2) Copy raw JSON payload */
+    /* 2) Read raw JSON payload directly into the command slot */
     if (pub->message.payload.len >= MAX_PAYLOAD_LEN) {
-        return;
+		LOG_WRN("Payload too long for %s", cmd->key);
+		reject_command(invalid_command_response, cmd);
+        goto release;
+    }
+    if (coo_mqtt_read_payload(client, cmd->payload, pub->message.payload.len) != 0) {
+        goto release;
     }
-    memcpy(cmd.payload, pub->message.payload.data, pub->message.payload.len);
-    cmd.payload[pub->message.payload.len] = '\0';
+    cmd->payload[pub->message.payload.len] = '\0';
+    cmd->payload_len = pub->message.payload.len;
 
 	// Parse msg type from json payload
-	if (!parse_msg_type_from_payload(cmd.payload, &cmd.msg_type)) {
-		LOG_WRN("No valid msg_type in JSON for %s", cmd.key);
-		struct OutMsg r = invalid_command_response(&cmd);
-		k_msgq_put(&outbound_queue, &r, K_NO_WAIT);
-		return;
+	if (!parse_msg_type_from_payload(cmd->payload, &cmd->msg_type)) {
+		LOG_WRN("No valid msg_type in JSON for %s", cmd->key);
+		reject_command(invalid_command_response, cmd);
+		goto release;
 	}
 
-	if (!(pub->prop.response_topic.utf8 && pub->prop.response_topic.size < sizeof(cmd.response_topic))) {
+	if (cmd->response_topic[0] == '\0') {
 		LOG_WRN("No valid response topic");
-		struct OutMsg r = invalid_command_response(&cmd);
-		k_msgq_put(&outbound_queue, &r, K_NO_WAIT);
-		return;
+		reject_command(invalid_command_response, cmd);
+		goto release;
 	}
-	memcpy(cmd.response_topic,
-		   pub->prop.response_topic.utf8,
-		   pub->prop.response_topic.size);
-	cmd.response_topic[pub->prop.response_topic.size] = '\0';
-
-    /* Save the broker's correlation_data so we can echo it back */
-    if (pub->prop.correlation_data.len > 0 &&
-        pub->prop.correlation_data.len < sizeof(cmd.correlation_data)) {
-        memcpy(cmd.correlation_data,
-               pub->prop.correlation_data.data,
-               pub->prop.correlation_data.len);
-        cmd.corr_len = pub->prop.correlation_data.len;
-    }
 
 	if (k_msgq_put(&inbound_queue, &cmd, K_NO_WAIT) != 0) {
-		LOG_WRN("Executor busy; rejecting cmd=%s", cmd.key);
-		/* Optional: send a "busy" NACK immediately */
-		struct OutMsg r = busy_response(&cmd);
-		k_msgq_put(&outbound_queue, &r, K_NO_WAIT);
+		/* Not expected: the slab holds no more commands than the queue */
+		metrics_queue_drop(METRICS_Q_INBOUND, 1);
+		reject_command(busy_response, cmd);
+		goto release;
+	}
+	metrics_queue_note(METRICS_Q_INBOUND);
+	return;
+
+release:
+	if (!busy) {
+		k_mem_slab_free(&command_slab, cmd);
 	}
 }
 
@@ -254,52 +232,21 @@ int main(void)
 	// 2. I need to ensure that MQTT properly stops/restarts across link failures.
 
 	int rc;
-	struct net_if *iface;
-	static uint16_t msg_id = 1;
-	const struct device *wdt = NULL;
-	int wdt_channel = -1;
-	int64_t last_wdt_feed = 0;
+	bool subscribed = false;
 
 	printk("HiSPEC-TIB Application %s\n", APP_VERSION_STRING);
 
-	/* Initialize watchdog */
-	watchdog_init(&wdt, &wdt_channel);
+	/* Hardware init on the system work queue while the network comes up */
+	boot_start();
 
-	/* Initialize devices */
-	devices_ready();
-	setup_mems_switches_and_routes();
-	setup_attenuators();
-
-    /* Initialize settings (persistent storage) */
-    rc = settings_subsys_init();
-    if (rc) {
-        LOG_ERR("Settings init failed (%d)", rc);
-    } else {
-        settings_load();
-    }
-
-	iface = net_if_get_default();
-	if (iface == NULL) {
-		LOG_ERR("No network interface configured");
-		return -ENETDOWN;
-	} else {
-		log_mac_addr(iface);
+	/* Brings the interfaces up; DHCP and broker resolution continue in the
+	 * background and complete the network stage
+	 */
+	rc = coo_network_init(NULL);
+	if (rc != 0) {
+		return rc;
 	}
 
-	LOG_INF("Bringing up network..");
-
-    /* Bring up all network interfaces managed by conn_mgr */
-    rc = conn_mgr_all_if_up(true);
-    if (rc) {
-        LOG_ERR("conn_mgr_all_if_up() failed (%d)", rc);
-    }
-
-	/* Wait for network using coo-common helper */
-	coo_network_init(NULL);
-	coo_network_wait_ready(0);
-
-	LOG_INF("Network stack ready (DHCP or static IP set).");
-
 	/* Initialize MQTT using coo-common library */
 	rc = coo_mqtt_init(&client_ctx, "hsfib-tib");
 	if (rc != 0) {
@@ -308,7 +255,12 @@ int main(void)
 	}
 
 	coo_mqtt_add_subscription(MQTT_CMD_PREFIX "#", MQTT_QOS_2_EXACTLY_ONCE);
-	coo_mqtt_set_message_callback(mqtt_command_handler);
+	coo_mqtt_set_publish_handler(mqtt_command_handler);
+	/* 50 Hz telemetry: cached header, 2-byte alias instead of the topic name */
+	coo_mqtt_channel_init(&photodiode_channel, PHOTODIODE_TOPIC);
+
+	/* Load saved state; the restore stage applies it once devices are up */
+	boot_settings();
 
 	/* Start executor thread */
 	k_thread_create(&exec_thread_data, exec_stack,
@@ -316,32 +268,50 @@ int main(void)
 				executor_thread_fn,
 				NULL, NULL, NULL,
 				EXECUTOR_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&exec_thread_data, "executor");
 
-	/* Start photodiode publisher */
-	k_work_init_delayable(&photodiode_publish_work, photodiode_publish_handler);
-	k_work_schedule(&photodiode_publish_work, K_NO_WAIT);
+	/* Start periodic metrics publisher */
+	metrics_start();
+
+	while (boot_wait(BIT(BOOT_NETWORK), K_SECONDS(10)) != 0) {
+		LOG_WRN("Network not ready yet (waiting...)");
+	}
+
+	/* Supervise the MQTT loop from here on; it checks in through the idle hook */
+	coo_mqtt_set_idle_hook(mqtt_checkin);
+	supervisor_register(SUPERVISOR_MQTT);
 
 	/* Main loop */
 	while (1) {
 		/* Block until MQTT connection is up */
 		coo_mqtt_connect(&client_ctx);
 		coo_mqtt_subscribe(&client_ctx);
+		if (!subscribed) {
+			subscribed = true;
+			boot_stage_done(BOOT_MQTT);
+			metrics_publish_boot();
+		}
 
 		/* Thread will primarily remain in this loop */
 		while (coo_mqtt_is_connected()) {
 
-			/* Feed watchdog periodically */
-			if (wdt && (k_uptime_get() - last_wdt_feed) >= WDT_FEED_INTERVAL_MS) {
-				rc = wdt_feed(wdt, wdt_channel);
-				if (rc) {
-					LOG_ERR("Failed to feed watchdog (%d)", rc);
-				}
-				last_wdt_feed = k_uptime_get();
-			}
-
-			/* 1) drain outbound_queue: publish everything */
+			/* 1) drain outbound queues: responses first, then metrics, then telemetry.
+			 * While the QoS 1/2 window is full only QoS 0 messages are taken;
+			 * PUBACKs handled in coo_mqtt_process() reopen it.
+			 */
 			struct OutMsg om;
-			while (k_msgq_get(&outbound_queue, &om, K_NO_WAIT) == 0) {
+			coo_mqtt_tx_cork();
+			while (outbound_get(&om, coo_mqtt_inflight_free() > 0) == 0) {
+
+				if (om.channel != NULL) {
+					rc = coo_mqtt_channel_publish(&client_ctx, om.channel,
+								      om.payload, om.payload_len);
+					if (rc != 0) {
+						LOG_ERR("MQTT Publish failed [%d]", rc);
+						metrics_inc(METRICS_PUBLISH_FAIL);
+					}
+					continue;
+				}
 
 				struct mqtt_publish_param param = {
 					.message.topic.qos = om.qos,
@@ -351,18 +321,26 @@ int main(void)
 					.message.payload.len = om.payload_len,
 					.prop.correlation_data.data = om.correlation_data,
 					.prop.correlation_data.len = om.corr_len,
-					.message_id = msg_id++,
 					.dup_flag = 0,
 					.retain_flag = 0,
 				};
 
-				rc = mqtt_publish(&client_ctx, &param);
+				rc = coo_mqtt_publish(&client_ctx, &param);
 				if (rc != 0) {
 					LOG_ERR("MQTT Publish failed [%d]", rc);
+					metrics_inc(METRICS_PUBLISH_FAIL);
 				}
 			}
+			/* Everything drained above goes out in as few sends as possible */
+			rc = coo_mqtt_tx_flush(&client_ctx);
+			if (rc != 0) {
+				LOG_ERR("MQTT TX flush failed [%d]", rc);
+				metrics_inc(METRICS_PUBLISH_FAIL);
+			}
 
+			/* 2) wait for inbound data or the next queued message */
 			rc = coo_mqtt_process(&client_ctx);
+			metrics_inc(METRICS_MQTT_WAKEUP);
 			if (rc != 0) {
 				break;
 			}
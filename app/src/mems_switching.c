@@ -4,6 +4,7 @@
 // mems_switching.c
 
 #include "mems_switching.h"
+#include "metrics.h"
 #include <zephyr/kernel.h>
 #include <string.h>
 #include <stdio.h>
@@ -29,6 +30,15 @@ void mems_switch_init(struct mems_switch *sw, const struct device *gpio_dev,
 }
 
 
+/* One expander write, timed for the I2C stats */
+static void pin_write(const struct mems_switch *sw, gpio_pin_t pin, int value)
+{
+    uint32_t start = k_cycle_get_32();
+
+    gpio_pin_set(sw->gpio_dev, pin, value);
+    metrics_i2c_record(METRICS_I2C_GPIO, k_cyc_to_us_floor32(k_cycle_get_32() - start));
+}
+
 int mems_switch_set_state(struct mems_switch *sw, char state)
 {
     gpio_pin_t pin;
@@ -42,11 +52,11 @@ int mems_switch_set_state(struct mems_switch *sw, char state)
     }
 
     // Pulse the control pin: low → high → low (with ms delays)
-    gpio_pin_set(sw->gpio_dev, pin, 0);
+    pin_write(sw, pin, 0);
     k_msleep(MEMS_SWITCH_PULSE_DELAY_MS);
-    gpio_pin_set(sw->gpio_dev, pin, 1);
+    pin_write(sw, pin, 1);
     k_msleep(MEMS_SWITCH_PULSE_DELAY_MS);
-    gpio_pin_set(sw->gpio_dev, pin, 0);
+    pin_write(sw, pin, 0);
     k_msleep(MEMS_SWITCH_PULSE_DELAY_MS);
 
     sw->state = state;
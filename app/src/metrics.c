@@ -0,0 +1,415 @@
+/*
+ * HiSPEC-TIB runtime metrics
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <coo_commons/mqtt_client.h>
+
+#include "metrics.h"
+#include "boot.h"
+#include "supervisor.h"
+#include "command.h"
+#include "photodiode.h"
+#include "outbound.h"
+
+LOG_MODULE_REGISTER(metrics, LOG_LEVEL_INF);
+
+#define METRICS_MAX_THREADS 16
+
+struct queue_stats {
+    const char *name;
+    struct k_msgq *msgq;
+    atomic_t hwm;
+    atomic_t drops;
+    /* queue-to-wire latency, only for outbound queues (EWMA, 1/16 weight) */
+    atomic_t lat_count;
+    atomic_t lat_avg_us;
+    atomic_t lat_max_us;
+};
+
+static struct queue_stats queues[METRICS_Q_COUNT] = {
+    [METRICS_Q_INBOUND]    = { .name = "inbound",    .msgq = &inbound_queue },
+    [METRICS_Q_RESPONSE]   = { .name = "response",   .msgq = &outbound_response_queue },
+    [METRICS_Q_METRICS]    = { .name = "metrics",    .msgq = &outbound_metrics_queue },
+    [METRICS_Q_TELEMETRY]  = { .name = "telemetry",  .msgq = &outbound_telemetry_queue },
+};
+
+static const char *const counter_names[METRICS_COUNTER_COUNT] = {
+    [METRICS_ADC_OVERRUN]  = "adc_overrun",
+    [METRICS_PUBLISH_FAIL] = "pub_fail",
+    [METRICS_MODBUS_ERROR] = "modbus_err",
+    [METRICS_CMD_BUSY]     = "busy",
+    [METRICS_MQTT_WAKEUP]  = "wakeups",
+};
+
+static atomic_t counters[METRICS_COUNTER_COUNT];
+
+struct i2c_stats {
+    const char *name;
+    atomic_t count;
+    atomic_t avg_us;        /* EWMA, 1/16 weight */
+    atomic_t max_us;
+};
+
+static struct i2c_stats i2c_devs[METRICS_I2C_COUNT] = {
+    [METRICS_I2C_ADC]  = { .name = "adc" },
+    [METRICS_I2C_DAC]  = { .name = "dac" },
+    [METRICS_I2C_GPIO] = { .name = "gpio" },
+};
+
+/* Per-thread cycle counts at the previous metrics_format_threads() call */
+struct thread_sample {
+    const struct k_thread *thread;
+    uint64_t cycles;
+};
+
+static struct thread_sample thread_prev[METRICS_MAX_THREADS];
+static uint64_t total_prev;
+static K_MUTEX_DEFINE(thread_lock);
+
+static struct k_work_delayable metrics_work;
+static struct coo_mqtt_channel metrics_channel;
+static struct coo_mqtt_channel threads_channel;
+
+
+void metrics_queue_note(enum metrics_queue q)
+{
+    atomic_val_t used = k_msgq_num_used_get(queues[q].msgq);
+    atomic_val_t hwm = atomic_get(&queues[q].hwm);
+
+    while (used > hwm) {
+        if (atomic_cas(&queues[q].hwm, hwm, used)) {
+            break;
+        }
+        hwm = atomic_get(&queues[q].hwm);
+    }
+}
+
+void metrics_queue_drop(enum metrics_queue q, uint32_t count)
+{
+    atomic_add(&queues[q].drops, count);
+}
+
+void metrics_inc(enum metrics_counter c)
+{
+    atomic_inc(&counters[c]);
+}
+
+void metrics_latency_record(enum metrics_queue q, uint32_t usec)
+{
+    struct queue_stats *qs = &queues[q];
+    atomic_val_t max = atomic_get(&qs->lat_max_us);
+    atomic_val_t avg = atomic_get(&qs->lat_avg_us);
+
+    /* Single writer (the MQTT loop), so read-modify-write is safe */
+    if (atomic_inc(&qs->lat_count) == 0) {
+        avg = usec;
+    } else {
+        avg += ((atomic_val_t)usec - avg) / 16;
+    }
+    atomic_set(&qs->lat_avg_us, avg);
+
+    while ((atomic_val_t)usec > max) {
+        if (atomic_cas(&qs->lat_max_us, max, usec)) {
+            break;
+        }
+        max = atomic_get(&qs->lat_max_us);
+    }
+}
+
+void metrics_i2c_record(enum metrics_i2c dev, uint32_t usec)
+{
+    struct i2c_stats *st = &i2c_devs[dev];
+    atomic_val_t avg = atomic_get(&st->avg_us);
+
+    if (atomic_inc(&st->count) == 0) {
+        avg = usec;
+    } else {
+        avg += ((atomic_val_t)usec - avg) / 16;
+    }
+    atomic_set(&st->avg_us, avg);
+    if ((atomic_val_t)usec > atomic_get(&st->max_us)) {
+        atomic_set(&st->max_us, usec);
+    }
+}
+
+int metrics_format_i2c(char *buf, size_t len)
+{
+    size_t offset;
+    int written;
+
+    written = snprintf(buf, len, "{\"i2c\":{");
+    if (written < 0 || written >= (int)len) {
+        return -ENOMEM;
+    }
+    offset = written;
+
+    for (int i = 0; i < METRICS_I2C_COUNT; i++) {
+        const struct i2c_stats *st = &i2c_devs[i];
+
+        /* "name":{"n":count,"us":[average, max]} */
+        written = snprintf(buf + offset, len - offset, "%s\"%s\":{\"n\":%ld,\"us\":[%ld,%ld]}",
+                           i > 0 ? "," : "", st->name, atomic_get(&st->count),
+                           atomic_get(&st->avg_us), atomic_get(&st->max_us));
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+
+    written = snprintf(buf + offset, len - offset, "}}");
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    return offset + written;
+}
+
+int metrics_format(char *buf, size_t len)
+{
+    size_t offset = 0;
+    int written;
+
+    written = snprintf(buf, len, "{\"uptime\":%lld,\"queues\":{", k_uptime_get() / 1000);
+    if (written < 0 || written >= (int)len) {
+        return -ENOMEM;
+    }
+    offset += written;
+
+    for (int i = 0; i < METRICS_Q_COUNT; i++) {
+        const struct queue_stats *qs = &queues[i];
+
+        written = snprintf(buf + offset, len - offset,
+                           "%s\"%s\":{\"used\":%u,\"size\":%u,\"hwm\":%ld,\"drops\":%ld",
+                           i > 0 ? "," : "", qs->name,
+                           k_msgq_num_used_get(qs->msgq), qs->msgq->max_msgs,
+                           atomic_get(&qs->hwm), atomic_get(&qs->drops));
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+
+        if (atomic_get(&qs->lat_count) > 0) {
+            /* "lat_us":[average, max] */
+            written = snprintf(buf + offset, len - offset, ",\"lat_us\":[%ld,%ld]",
+                               atomic_get(&qs->lat_avg_us), atomic_get(&qs->lat_max_us));
+            if (written < 0 || written >= (int)(len - offset)) {
+                return -ENOMEM;
+            }
+            offset += written;
+        }
+
+        written = snprintf(buf + offset, len - offset, "}");
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+
+    written = snprintf(buf + offset, len - offset, "}");
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    offset += written;
+
+    for (int i = 0; i < METRICS_COUNTER_COUNT; i++) {
+        written = snprintf(buf + offset, len - offset, ",\"%s\":%ld",
+                           counter_names[i], atomic_get(&counters[i]));
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+
+    struct coo_mqtt_stats mqtt;
+
+    coo_mqtt_get_stats(&mqtt);
+    written = snprintf(buf + offset, len - offset,
+                       ",\"mqtt\":{\"pub\":%u,\"acked\":%u,\"inflight\":%u,\"retx\":%u,"
+                       "\"full\":%u,\"tx\":[%u,%u],\"conn\":[%u,%u]}}",
+                       mqtt.published, mqtt.acked, mqtt.inflight, mqtt.retransmitted,
+                       mqtt.window_full, mqtt.tx_packets, mqtt.tx_sends,
+                       mqtt.connects, mqtt.connect_time_ms);
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    return offset + written;
+}
+
+
+struct thread_format_ctx {
+    char *buf;
+    size_t len;
+    size_t offset;
+    uint64_t total_delta;
+    int count;
+    bool overflow;
+};
+
+static uint64_t thread_prev_swap(const struct k_thread *thread, uint64_t cycles)
+{
+    struct thread_sample *free_slot = NULL;
+
+    for (int i = 0; i < METRICS_MAX_THREADS; i++) {
+        if (thread_prev[i].thread == thread) {
+            uint64_t prev = thread_prev[i].cycles;
+            thread_prev[i].cycles = cycles;
+            return prev;
+        }
+        if (!free_slot && thread_prev[i].thread == NULL) {
+            free_slot = &thread_prev[i];
+        }
+    }
+
+    if (free_slot) {
+        free_slot->thread = thread;
+        free_slot->cycles = cycles;
+    }
+    return 0;
+}
+
+static void format_thread_cb(const struct k_thread *cthread, void *user_data)
+{
+    struct thread_format_ctx *ctx = user_data;
+    struct k_thread *thread = (struct k_thread *)cthread;
+    k_thread_runtime_stats_t stats;
+    size_t unused = 0;
+    uint32_t permille = 0;
+    const char *name;
+    int written;
+
+    if (ctx->overflow) {
+        return;
+    }
+
+    if (k_thread_runtime_stats_get(thread, &stats) == 0) {
+        uint64_t prev = thread_prev_swap(cthread, stats.execution_cycles);
+
+        if (ctx->total_delta > 0 && stats.execution_cycles >= prev) {
+            permille = (uint32_t)(((stats.execution_cycles - prev) * 1000U) / ctx->total_delta);
+        }
+    }
+
+    (void)k_thread_stack_space_get(cthread, &unused);
+
+    name = k_thread_name_get(thread);
+    if (name == NULL || name[0] == '\0') {
+        name = "?";
+    }
+
+    /* "name":[cpu permille, stack bytes unused, stack size(, ms since check-in)] */
+    int64_t age = supervisor_checkin_age(thread);
+    char age_str[12] = "";
+
+    if (age >= 0) {
+        snprintf(age_str, sizeof(age_str), ",%u", (uint32_t)age);
+    }
+    written = snprintf(ctx->buf + ctx->offset, ctx->len - ctx->offset,
+                       "%s\"%s\":[%u,%zu,%zu%s]", ctx->count > 0 ? "," : "",
+                       name, permille, unused, cthread->stack_info.size, age_str);
+    if (written < 0 || written >= (int)(ctx->len - ctx->offset) - 2) {
+        /* keep room to close the object */
+        ctx->overflow = true;
+        ctx->buf[ctx->offset] = '\0';
+        return;
+    }
+    ctx->offset += written;
+    ctx->count++;
+}
+
+int metrics_format_threads(char *buf, size_t len)
+{
+    k_thread_runtime_stats_t all;
+    struct thread_format_ctx ctx = {
+        .buf = buf,
+        .len = len,
+    };
+    int written;
+
+    written = snprintf(buf, len, "{\"threads\":{");
+    if (written < 0 || written >= (int)len) {
+        return -ENOMEM;
+    }
+    ctx.offset = written;
+
+    k_mutex_lock(&thread_lock, K_FOREVER);
+
+    if (k_thread_runtime_stats_all_get(&all) == 0) {
+        ctx.total_delta = all.execution_cycles - total_prev;
+        total_prev = all.execution_cycles;
+    }
+
+    k_thread_foreach_unlocked(format_thread_cb, &ctx);
+
+    k_mutex_unlock(&thread_lock);
+
+    written = snprintf(buf + ctx.offset, len - ctx.offset, "}%s}",
+                       ctx.overflow ? ",\"truncated\":true" : "");
+    if (written < 0 || written >= (int)(len - ctx.offset)) {
+        return -ENOMEM;
+    }
+    return ctx.offset + written;
+}
+
+
+static void metrics_publish(struct coo_mqtt_channel *channel, int (*format)(char *, size_t))
+{
+    struct OutMsg msg = { 0 };
+    int len;
+
+    len = format(msg.payload, sizeof(msg.payload));
+    if (len < 0) {
+        LOG_WRN("Metrics for %s do not fit in a payload", channel->topic);
+        return;
+    }
+
+    msg.msg_type = RESP_OK;
+    msg.qos = MQTT_QOS_0_AT_MOST_ONCE;
+    msg.payload_len = len;
+    msg.channel = channel;
+
+    (void)outbound_put(OUT_METRICS, &msg, K_NO_WAIT);
+}
+
+void metrics_publish_boot(void)
+{
+    struct OutMsg msg = { 0 };
+    int len;
+
+    len = boot_format(msg.payload, sizeof(msg.payload));
+    if (len < 0) {
+        return;
+    }
+
+    /* One-off: QoS 1 so the start-up record is not lost to a busy link */
+    strncpy(msg.topic, METRICS_BOOT_TOPIC, sizeof(msg.topic) - 1);
+    msg.msg_type = RESP_OK;
+    msg.qos = MQTT_QOS_1_AT_LEAST_ONCE;
+    msg.payload_len = len;
+
+    (void)outbound_put(OUT_METRICS, &msg, K_NO_WAIT);
+}
+
+static void metrics_publish_handler(struct k_work *work)
+{
+    metrics_publish(&metrics_channel, metrics_format);
+    metrics_publish(&threads_channel, metrics_format_threads);
+
+    k_work_schedule(&metrics_work, K_MSEC(CONFIG_APP_METRICS_PUBLISH_INTERVAL_MS));
+}
+
+void metrics_start(void)
+{
+    coo_mqtt_channel_init(&metrics_channel, METRICS_TOPIC);
+    coo_mqtt_channel_init(&threads_channel, METRICS_THREADS_TOPIC);
+    k_work_init_delayable(&metrics_work, metrics_publish_handler);
+    if (CONFIG_APP_METRICS_PUBLISH_INTERVAL_MS > 0) {
+        k_work_schedule(&metrics_work, K_MSEC(CONFIG_APP_METRICS_PUBLISH_INTERVAL_MS));
+    }
+}
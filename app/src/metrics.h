@@ -0,0 +1,103 @@
+/*
+ * HiSPEC-TIB runtime metrics
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <zephyr/kernel.h>
+#include <stddef.h>
+
+#define METRICS_TOPIC "dt/hsfib-tib/metrics"
+#define METRICS_THREADS_TOPIC "dt/hsfib-tib/metrics/threads"
+#define METRICS_BOOT_TOPIC "dt/hsfib-tib/metrics/boot"
+
+/* Message queues whose depth and drops are tracked */
+enum metrics_queue {
+    METRICS_Q_INBOUND,
+    METRICS_Q_RESPONSE,
+    METRICS_Q_METRICS,
+    METRICS_Q_TELEMETRY,
+    METRICS_Q_COUNT
+};
+
+/* Event counters */
+enum metrics_counter {
+    METRICS_ADC_OVERRUN,      /* photodiode loop missed its interval */
+    METRICS_PUBLISH_FAIL,     /* mqtt_publish() returned an error */
+    METRICS_MODBUS_ERROR,     /* Maiman register read/write failed */
+    METRICS_CMD_BUSY,         /* command rejected because the executor was busy */
+    METRICS_MQTT_WAKEUP,      /* MQTT loop iterations (socket data, queued message or timeout) */
+    METRICS_COUNTER_COUNT
+};
+
+/**
+ * Record the current depth of a queue after a successful put.
+ * Updates the high-water mark.
+ */
+void metrics_queue_note(enum metrics_queue q);
+
+/* I2C devices whose transaction times are tracked */
+enum metrics_i2c {
+    METRICS_I2C_ADC,          /* ADS1115, bus time beyond the conversion delays */
+    METRICS_I2C_DAC,          /* DAC7578 attenuator write */
+    METRICS_I2C_GPIO,         /* PCAL6416A MEMS pin write */
+    METRICS_I2C_COUNT
+};
+
+/**
+ * Record messages dropped from (or refused by) a queue.
+ */
+void metrics_queue_drop(enum metrics_queue q, uint32_t count);
+
+/**
+ * Increment an event counter.
+ */
+void metrics_inc(enum metrics_counter c);
+
+/**
+ * Record the time a message spent between outbound_put() and being taken
+ * by the MQTT loop for publication.
+ */
+void metrics_latency_record(enum metrics_queue q, uint32_t usec);
+
+/**
+ * Record the duration of one transaction with an I2C device. One writer
+ * per device: its callers are already serialized.
+ */
+void metrics_i2c_record(enum metrics_i2c dev, uint32_t usec);
+
+/**
+ * Format queue and event counters as JSON.
+ * @return Number of bytes written (excluding NUL), or negative on overflow
+ */
+int metrics_format(char *buf, size_t len);
+
+/**
+ * Format per-thread CPU utilization (permille since the previous call) and
+ * stack usage as JSON.
+ * @return Number of bytes written (excluding NUL), or negative on overflow
+ */
+int metrics_format_threads(char *buf, size_t len);
+
+/**
+ * Format per-device I2C transaction counts and times as JSON.
+ * @return Number of bytes written (excluding NUL), or negative on overflow
+ */
+int metrics_format_i2c(char *buf, size_t len);
+
+/**
+ * Queue the boot stage timings (see boot_format()) on METRICS_BOOT_TOPIC.
+ * Called once, when the first MQTT session is up.
+ */
+void metrics_publish_boot(void);
+
+/**
+ * Start periodic publication on METRICS_TOPIC / METRICS_THREADS_TOPIC.
+ * Registers their publish channels, so call before coo_mqtt_connect().
+ */
+void metrics_start(void);
+
+#endif //METRICS_H
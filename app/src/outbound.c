@@ -0,0 +1,80 @@
+/*
+ * HiSPEC-TIB outbound publish queues
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <coo_commons/mqtt_client.h>
+
+#include "outbound.h"
+#include "metrics.h"
+
+K_MSGQ_DEFINE(outbound_response_queue, sizeof(struct OutMsg),
+              CONFIG_APP_OUTBOUND_RESPONSE_DEPTH, 4);
+K_MSGQ_DEFINE(outbound_metrics_queue, sizeof(struct OutMsg),
+              CONFIG_APP_OUTBOUND_METRICS_DEPTH, 4);
+K_MSGQ_DEFINE(outbound_telemetry_queue, sizeof(struct OutMsg),
+              CONFIG_APP_OUTBOUND_TELEMETRY_DEPTH, 4);
+
+struct out_class {
+    struct k_msgq *msgq;
+    enum metrics_queue metric;
+};
+
+/* Indexed by enum OutClass, which is also the drain order */
+static const struct out_class classes[OUT_CLASS_COUNT] = {
+    [OUT_RESPONSE]  = { &outbound_response_queue,  METRICS_Q_RESPONSE },
+    [OUT_METRICS]   = { &outbound_metrics_queue,   METRICS_Q_METRICS },
+    [OUT_TELEMETRY] = { &outbound_telemetry_queue, METRICS_Q_TELEMETRY },
+};
+
+int outbound_put(enum OutClass cls, struct OutMsg *msg, k_timeout_t timeout)
+{
+    const struct out_class *c = &classes[cls];
+
+    msg->queued_at = k_cycle_get_32();
+
+    if (cls == OUT_TELEMETRY) {
+        /* Drop-oldest: newer samples are worth more than stale ones */
+        while (k_msgq_put(c->msgq, msg, K_NO_WAIT) != 0) {
+            struct OutMsg stale;
+
+            if (k_msgq_get(c->msgq, &stale, K_NO_WAIT) == 0) {
+                metrics_queue_drop(c->metric, 1);
+            }
+        }
+    } else if (k_msgq_put(c->msgq, msg, timeout) != 0) {
+        metrics_queue_drop(c->metric, 1);
+        return -ENOMSG;
+    }
+
+    metrics_queue_note(c->metric);
+    coo_mqtt_wake();
+    return 0;
+}
+
+/* Channel streams are always QoS 0 and never take an in-flight slot */
+static bool needs_ack(const struct OutMsg *msg)
+{
+    return msg->channel == NULL && msg->qos > MQTT_QOS_0_AT_MOST_ONCE;
+}
+
+int outbound_get(struct OutMsg *msg, bool acked)
+{
+    for (int i = 0; i < OUT_CLASS_COUNT; i++) {
+        /* This thread is the only reader apart from telemetry's
+         * drop-oldest, and telemetry is all QoS 0, so the head peeked
+         * is the head taken, or one just as cheap to send
+         */
+        if (!acked && (k_msgq_peek(classes[i].msgq, msg) != 0 || needs_ack(msg))) {
+            continue;
+        }
+        if (k_msgq_get(classes[i].msgq, msg, K_NO_WAIT) == 0) {
+            metrics_latency_record(classes[i].metric,
+                                   k_cyc_to_us_floor32(k_cycle_get_32() - msg->queued_at));
+            return 0;
+        }
+    }
+    return -EAGAIN;
+}
@@ -0,0 +1,51 @@
+/*
+ * HiSPEC-TIB outbound publish queues
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OUTBOUND_H
+#define OUTBOUND_H
+
+#include <zephyr/kernel.h>
+
+#include "command.h"
+
+/* Publish classes, highest priority first */
+enum OutClass {
+    OUT_RESPONSE,   /* command responses and NACKs; never displaced */
+    OUT_METRICS,    /* metrics and log batches */
+    OUT_TELEMETRY,  /* periodic samples; oldest entry dropped when full */
+    OUT_CLASS_COUNT
+};
+
+/**
+ * Queue a message for publication in the given class.
+ *
+ * OUT_RESPONSE and OUT_METRICS wait up to @p timeout for space.
+ * OUT_TELEMETRY never waits: when full, the oldest sample is discarded to
+ * make room. Queue depth and drops are recorded in the metrics module.
+ * The MQTT loop is woken so the message goes out without waiting for the
+ * next poll timeout.
+ *
+ * @return 0 on success, -ENOMSG if the message was dropped
+ */
+int outbound_put(enum OutClass cls, struct OutMsg *msg, k_timeout_t timeout);
+
+/**
+ * Take the next message to publish, serving responses before metrics and
+ * metrics before telemetry. Records the time the message spent queued.
+ *
+ * @param acked  False while the QoS 1/2 in-flight window is full. A class
+ *               whose next message needs an acknowledgment is then passed
+ *               over, so QoS 0 traffic (telemetry, most metrics) keeps
+ *               draining. Order within a class is kept.
+ * @return 0 on success, -EAGAIN if no class has a message to take
+ */
+int outbound_get(struct OutMsg *msg, bool acked);
+
+extern struct k_msgq outbound_response_queue;
+extern struct k_msgq outbound_metrics_queue;
+extern struct k_msgq outbound_telemetry_queue;
+
+#endif //OUTBOUND_H
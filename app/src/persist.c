@@ -0,0 +1,394 @@
+/*
+ * HiSPEC-TIB persistent device state
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Keeps a shadow copy of the persistent state. Setters update the shadow
+ * and set a dirty bit under a spinlock; the flush work item snapshots the
+ * dirty items and writes them with settings_save_one(). Settings loaded at
+ * boot land in the same shadow and are applied by persist_restore().
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "persist.h"
+#include "devices.h"
+#include "epoch.h"
+#include "maiman.h"
+#include "mems_switching.h"
+
+LOG_MODULE_REGISTER(persist, CONFIG_APP_LOG_LEVEL);
+
+/* Registers restored on power-up, in write order */
+static const uint16_t laser_setpoint_regs[] = {
+    REG_CURRENT_MAX_LIMIT,
+    REG_CURRENT_PROTECTION_THRESHOLD,
+    REG_TEC_TEMPERATURE_VALUE,
+    REG_FREQUENCY,
+    REG_DURATION,
+    REG_CURRENT,
+};
+
+struct atten_state {
+    double coeff_db_to_volt[ATTEN_NUM_COEFFS];
+    double coeff_volt_to_db[ATTEN_NUM_COEFFS];
+    double voltage;
+};
+
+/*
+ * tib/atten/<n> as stored: a header, then the voltage and both curves of
+ * ncoeffs terms each, so a record outlives a change of
+ * CONFIG_APP_ATTEN_FIT_ORDER. Records from before the header are a bare
+ * struct atten_state, an odd number of doubles; these have an even number.
+ */
+#define ATTEN_RECORD_VERSION 1
+#define ATTEN_RECORD_MAX_COEFFS 8
+
+struct atten_record_hdr {
+    uint8_t version;
+    uint8_t ncoeffs;
+    uint8_t reserved[6];    /* keeps the doubles aligned */
+};
+
+/* Header, voltage, db2volt[ncoeffs], volt2db[ncoeffs] */
+#define ATTEN_RECORD_DOUBLES(n) (1 + 1 + 2 * (n))
+
+BUILD_ASSERT(ATTEN_NUM_COEFFS <= ATTEN_RECORD_MAX_COEFFS, "fit order beyond the record");
+
+struct laser_state {
+    uint16_t valid;         /* bit i set: value[i] holds a setpoint */
+    uint16_t value[ARRAY_SIZE(laser_setpoint_regs)];
+};
+
+/* Dirty/loaded bits: one per attenuator, then MEMS, then one per laser */
+#define BIT_ATTEN(i)  BIT(i)
+#define BIT_MEMS      BIT(NUM_ATTENUATORS)
+#define BIT_LASER(n)  BIT(NUM_ATTENUATORS + 1 + (n))
+
+static struct k_spinlock lock;
+static struct atten_state atten[NUM_ATTENUATORS];
+static uint32_t atten_curves;   /* bit i: atten[i] curves were loaded */
+static char mems[MEMS_ROUTER_MAX_SWITCHES];
+static struct laser_state lasers[NUM_LASER_NODES];
+static uint32_t dirty;
+static uint32_t loaded;
+
+static struct k_work_delayable flush_work;
+static bool work_ready;
+
+static void flush_handler(struct k_work *work);
+
+static void init_work(void)
+{
+    if (!work_ready) {
+        k_work_init_delayable(&flush_work, flush_handler);
+        work_ready = true;
+    }
+}
+
+static void mark_dirty(uint32_t bits)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    dirty |= bits;
+    k_spin_unlock(&lock, key);
+
+    init_work();
+    /* Start the window on the first change; later ones join it */
+    k_work_schedule(&flush_work, K_MSEC(CONFIG_APP_PERSIST_FLUSH_DELAY_MS));
+}
+
+void persist_save_atten(int index, const struct attenuator *drv)
+{
+    if (index < 0 || index >= NUM_ATTENUATORS) {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    memcpy(atten[index].coeff_db_to_volt, drv->coeff_db_to_volt,
+           sizeof(atten[index].coeff_db_to_volt));
+    memcpy(atten[index].coeff_volt_to_db, drv->coeff_volt_to_db,
+           sizeof(atten[index].coeff_volt_to_db));
+    atten[index].voltage = drv->voltage;
+    k_spin_unlock(&lock, key);
+
+    mark_dirty(BIT_ATTEN(index));
+}
+
+void persist_save_mems(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    for (int i = 0; i < MEMS_ROUTER_MAX_SWITCHES; i++) {
+        mems[i] = mems_switches[i].state;
+    }
+    k_spin_unlock(&lock, key);
+
+    mark_dirty(BIT_MEMS);
+}
+
+void persist_save_laser(uint8_t node, uint16_t address, uint16_t value)
+{
+    if (node >= NUM_LASER_NODES) {
+        return;
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(laser_setpoint_regs); i++) {
+        if (laser_setpoint_regs[i] != address) {
+            continue;
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&lock);
+
+        lasers[node].value[i] = value;
+        lasers[node].valid |= BIT(i);
+        k_spin_unlock(&lock, key);
+
+        mark_dirty(BIT_LASER(node));
+        return;
+    }
+}
+
+static void flush_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    struct atten_state atten_copy[NUM_ATTENUATORS];
+    char mems_copy[MEMS_ROUTER_MAX_SWITCHES];
+    struct laser_state laser_copy[NUM_LASER_NODES];
+    char name[24];
+    uint32_t todo;
+    int rc;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    todo = dirty;
+    dirty = 0;
+    memcpy(atten_copy, atten, sizeof(atten));
+    memcpy(mems_copy, mems, sizeof(mems));
+    memcpy(laser_copy, lasers, sizeof(lasers));
+    k_spin_unlock(&lock, key);
+
+    for (int i = 0; i < NUM_ATTENUATORS; i++) {
+        if (todo & BIT_ATTEN(i)) {
+            double record[ATTEN_RECORD_DOUBLES(ATTEN_NUM_COEFFS)];
+            struct atten_record_hdr hdr = {
+                .version = ATTEN_RECORD_VERSION,
+                .ncoeffs = ATTEN_NUM_COEFFS,
+            };
+
+            memcpy(&record[0], &hdr, sizeof(hdr));
+            record[1] = atten_copy[i].voltage;
+            memcpy(&record[2], atten_copy[i].coeff_db_to_volt,
+                   sizeof(atten_copy[i].coeff_db_to_volt));
+            memcpy(&record[2 + ATTEN_NUM_COEFFS], atten_copy[i].coeff_volt_to_db,
+                   sizeof(atten_copy[i].coeff_volt_to_db));
+
+            snprintf(name, sizeof(name), "tib/atten/%d", i);
+            rc = settings_save_one(name, record, sizeof(record));
+            if (rc != 0) {
+                LOG_ERR("Failed to save %s (%d)", name, rc);
+            }
+        }
+    }
+
+    if (todo & BIT_MEMS) {
+        rc = settings_save_one("tib/mems", mems_copy, sizeof(mems_copy));
+        if (rc != 0) {
+            LOG_ERR("Failed to save tib/mems (%d)", rc);
+        }
+    }
+
+    for (int n = 0; n < NUM_LASER_NODES; n++) {
+        if (todo & BIT_LASER(n)) {
+            snprintf(name, sizeof(name), "tib/laser/%d", n);
+            rc = settings_save_one(name, &laser_copy[n], sizeof(laser_copy[n]));
+            if (rc != 0) {
+                LOG_ERR("Failed to save %s (%d)", name, rc);
+            }
+        }
+    }
+
+    if (todo != 0) {
+        LOG_DBG("Saved state (mask 0x%x)", todo);
+    }
+}
+
+void persist_flush(void)
+{
+    struct k_work_sync sync;
+
+    init_work();
+    k_work_reschedule(&flush_work, K_NO_WAIT);
+    (void)k_work_flush_delayable(&flush_work, &sync);
+}
+
+void persist_restore(void)
+{
+    int64_t start = k_uptime_get();
+    int restored = 0;
+
+    for (int i = 0; i < NUM_ATTENUATORS; i++) {
+        if (!(loaded & BIT_ATTEN(i))) {
+            continue;
+        }
+        if (atten_curves & BIT(i)) {
+            memcpy(attenuators[i].coeff_db_to_volt, atten[i].coeff_db_to_volt,
+                   sizeof(atten[i].coeff_db_to_volt));
+            memcpy(attenuators[i].coeff_volt_to_db, atten[i].coeff_volt_to_db,
+                   sizeof(atten[i].coeff_volt_to_db));
+        }
+        if (!attenuator_set(&attenuators[i], atten[i].voltage, true)) {
+            LOG_ERR("Failed to restore attenuator %d", i);
+            continue;
+        }
+        restored++;
+    }
+
+    if (loaded & BIT_MEMS) {
+        for (int i = 0; i < MEMS_ROUTER_MAX_SWITCHES; i++) {
+            if (mems[i] != 'A' && mems[i] != 'B') {
+                continue;
+            }
+            if (mems_switch_set_state(&mems_switches[i], mems[i]) != 0) {
+                LOG_ERR("Failed to restore MEMS switch %s", mems_switches[i].name);
+                continue;
+            }
+            restored++;
+        }
+    }
+
+    LOG_INF("Restored %d item(s) in %lld ms", restored, k_uptime_get() - start);
+}
+
+void persist_restore_lasers(void)
+{
+    struct laser_state copy[NUM_LASER_NODES];
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    memcpy(copy, lasers, sizeof(lasers));
+    k_spin_unlock(&lock, key);
+
+    for (int n = 0; n < NUM_LASER_NODES; n++) {
+        maiman_driver_t driver = { .node_id = n };
+
+        for (int i = 0; i < ARRAY_SIZE(laser_setpoint_regs); i++) {
+            if (!(copy[n].valid & BIT(i))) {
+                continue;
+            }
+            if (!maiman_write_u16(&driver, laser_setpoint_regs[i], copy[n].value[i])) {
+                LOG_ERR("Failed to restore laser %d register 0x%04x", n,
+                        laser_setpoint_regs[i]);
+                continue;
+            }
+            epoch_laser_written(n, laser_setpoint_regs[i], copy[n].value[i]);
+        }
+    }
+}
+
+/*
+ * Load tib/atten/<index>, either layout. Curves of a lower order than the
+ * build's are padded with zero terms, which is the same polynomial. Higher
+ * order curves cannot be represented; only the voltage is kept and the
+ * attenuator needs recalibrating.
+ */
+static int load_atten(int index, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    double raw[ATTEN_RECORD_DOUBLES(ATTEN_RECORD_MAX_COEFFS)];
+    size_t doubles = len / sizeof(double);
+    const double *db2volt;
+    const double *volt2db;
+    double voltage;
+    int n;
+
+    if (len > sizeof(raw) || len % sizeof(double) != 0 || doubles < 3 ||
+        read_cb(cb_arg, raw, len) != (ssize_t)len) {
+        return -EINVAL;
+    }
+
+    if (doubles % 2 == 1) {
+        /* Unversioned: db2volt[n], volt2db[n], voltage */
+        n = (doubles - 1) / 2;
+        db2volt = &raw[0];
+        volt2db = &raw[n];
+        voltage = raw[2 * n];
+    } else {
+        struct atten_record_hdr hdr;
+
+        memcpy(&hdr, &raw[0], sizeof(hdr));
+        n = hdr.ncoeffs;
+        if (hdr.version != ATTEN_RECORD_VERSION || doubles != (size_t)ATTEN_RECORD_DOUBLES(n)) {
+            return -EINVAL;
+        }
+        voltage = raw[1];
+        db2volt = &raw[2];
+        volt2db = &raw[2 + n];
+    }
+
+    atten[index].voltage = voltage;
+    loaded |= BIT_ATTEN(index);
+
+    if (n > ATTEN_NUM_COEFFS) {
+        LOG_WRN("Attenuator %d calibration is order %d, above CONFIG_APP_ATTEN_FIT_ORDER; "
+                "recalibrate", index, n - 1);
+        return 0;
+    }
+    if (n != ATTEN_NUM_COEFFS) {
+        LOG_INF("Attenuator %d calibration is order %d, padded to %d", index, n - 1,
+                ATTEN_NUM_COEFFS - 1);
+    }
+    memset(atten[index].coeff_db_to_volt, 0, sizeof(atten[index].coeff_db_to_volt));
+    memset(atten[index].coeff_volt_to_db, 0, sizeof(atten[index].coeff_volt_to_db));
+    memcpy(atten[index].coeff_db_to_volt, db2volt, n * sizeof(double));
+    memcpy(atten[index].coeff_volt_to_db, volt2db, n * sizeof(double));
+    atten_curves |= BIT(index);
+    return 0;
+}
+
+static int persist_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+                                void *cb_arg)
+{
+    const char *next;
+    int index;
+
+    if (settings_name_steq(name, "mems", NULL)) {
+        if (len != sizeof(mems) || read_cb(cb_arg, mems, sizeof(mems)) != sizeof(mems)) {
+            return -EINVAL;
+        }
+        loaded |= BIT_MEMS;
+        return 0;
+    }
+
+    if (settings_name_steq(name, "atten", &next) && next != NULL) {
+        index = atoi(next);
+        if (index < 0 || index >= NUM_ATTENUATORS) {
+            return -EINVAL;
+        }
+        return load_atten(index, len, read_cb, cb_arg);
+    }
+
+    if (settings_name_steq(name, "laser", &next) && next != NULL) {
+        index = atoi(next);
+        if (index < 0 || index >= NUM_LASER_NODES || len != sizeof(lasers[index]) ||
+            read_cb(cb_arg, &lasers[index], sizeof(lasers[index])) != sizeof(lasers[index])) {
+            return -EINVAL;
+        }
+        loaded |= BIT_LASER(index);
+        return 0;
+    }
+
+    return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(tib, "tib",
+    NULL, //get
+    persist_settings_set, //set
+    NULL, //commit
+    NULL); //export
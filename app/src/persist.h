@@ -0,0 +1,51 @@
+/*
+ * HiSPEC-TIB persistent device state
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <zephyr/kernel.h>
+#include <stdint.h>
+
+#include "attenuator.h"
+
+/*
+ * Device state kept in settings under "tib/": attenuator coefficients and
+ * voltages, MEMS switch states and Maiman laser setpoints. The persist_save_*
+ * calls only copy the new value and mark it dirty; a delayed flush writes
+ * everything that changed within CONFIG_APP_PERSIST_FLUSH_DELAY_MS, so a
+ * burst of set commands costs one flash write per item.
+ */
+
+/** Record attenuator @p index after its coefficients or voltage changed */
+void persist_save_atten(int index, const struct attenuator *drv);
+
+/** Record the current state of every MEMS switch */
+void persist_save_mems(void);
+
+/**
+ * Record a laser setpoint written over Modbus. Registers that are not
+ * setpoints (measurements, the start/stop command) are ignored, so a
+ * laser never starts by itself after a reboot.
+ */
+void persist_save_laser(uint8_t node, uint16_t address, uint16_t value);
+
+/** Write pending changes now instead of waiting for the flush delay */
+void persist_flush(void);
+
+/**
+ * Apply the attenuator and MEMS state loaded by settings_load() to the
+ * hardware. Runs as the restore boot stage, once both are available.
+ */
+void persist_restore(void);
+
+/**
+ * Write the saved setpoints to every laser controller. Call after the
+ * controllers have been powered up and have booted.
+ */
+void persist_restore_lasers(void);
+
+#endif //PERSIST_H
@@ -10,12 +10,23 @@
 #include <zephyr/logging/log.h>        // LOG_ERR, LOG_WRN, etc.
 #include <zephyr/net/sntp.h>
 #include <stdint.h>                 // int16_t, int64_t, etc.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 // #include <zephyr/posix/time.h>
 // #include <limits.h>
 
 #include "photodiode.h"
+#include "ads1115.h"
 #include "command.h"
 #include "devices.h"
+#include "metrics.h"
+#include "outbound.h"
+#include "log_ratelimit.h"
+#include "supervisor.h"
+#include "history.h"
+#include "epoch.h"
+#include "lockin.h"
 
 
 LOG_MODULE_REGISTER(photodiode, LOG_LEVEL_INF);
@@ -27,89 +38,308 @@ LOG_MODULE_REGISTER(photodiode, LOG_LEVEL_INF);
 
 // static const struct device *adc_dev = DEVICE_DT_GET_OR_NULL(DT_NODELABEL(adc1115));
 
-static const struct adc_channel_cfg yj_cfg_dt =
-    ADC_CHANNEL_CFG_DT(DT_CHILD(DT_NODELABEL(adc1115), channel_0));
+static const struct adc_channel_cfg channel_cfg_dt[PD_CHANNEL_COUNT] = {
+    [PD_YJ] = ADC_CHANNEL_CFG_DT(DT_CHILD(DT_NODELABEL(adc1115), channel_0)),
+    [PD_HK] = ADC_CHANNEL_CFG_DT(DT_CHILD(DT_NODELABEL(adc1115), channel_1)),
+};
 
-static const struct adc_channel_cfg hk_cfg_dt =
-    ADC_CHANNEL_CFG_DT(DT_CHILD(DT_NODELABEL(adc1115), channel_1));
+static const char *const channel_names[PD_CHANNEL_COUNT] = { "YJ", "HK" };
 
-K_MSGQ_DEFINE(photodiode_queue, sizeof(struct OutMsg), 4, 4);
+/* Input each channel's zephyr,input-positive selects, against GND */
+static const uint8_t channel_ain[PD_CHANNEL_COUNT] = {
+    [PD_YJ] = DT_PROP(DT_CHILD(DT_NODELABEL(adc1115), channel_0), zephyr_input_positive),
+    [PD_HK] = DT_PROP(DT_CHILD(DT_NODELABEL(adc1115), channel_1), zephyr_input_positive),
+};
+
+/* ADS1115 at 860 SPS, its fastest data rate */
+#define PD_FAST_PERIOD_US 1163
+
+/*
+ * Auto-ranging PGA settings, widest first, as the Zephyr ADS1x1x bindings
+ * name them against a 2.048 V reference: ADC_GAIN_1_3 is +/-6.144 V.
+ */
+static const enum adc_gain gain_ladder[] = {
+    ADC_GAIN_1_3, ADC_GAIN_1_2, ADC_GAIN_1, ADC_GAIN_2, ADC_GAIN_4, ADC_GAIN_8,
+};
+static const uint16_t gain_fsr_mv[] = {
+    6144, 4096, 2048, 1024, 512, 256,
+};
+
+/* Range down (more gain) only once it would leave this much headroom */
+#define RANGE_UP_LIMIT    (INT16_MAX * 9 / 10)
+#define RANGE_DOWN_LIMIT  (INT16_MAX * 3 / 4)
+
+/* Current ladder index per channel, and the devicetree gain as the floor */
+static atomic_t gain_idx[PD_CHANNEL_COUNT];
+static uint8_t gain_floor[PD_CHANNEL_COUNT];
+static uint16_t range_dwell[PD_CHANNEL_COUNT];
+static atomic_t gain_holds;
+
+/* Time left in each interval, while a lock-in runs, for a last 860 SPS read
+ * to finish and for publishing
+ */
+#define LOCKIN_SLACK_MS 4
+
+/* The ADS1115 multiplexes both channels through one converter */
+static K_MUTEX_DEFINE(adc_lock);
+
+/* Pre-encoded publish header for PHOTODIODE_TOPIC, set up in main() */
+struct coo_mqtt_channel photodiode_channel;
+
+/* Publish every Nth sample; 0 stops streaming. History keeps every sample. */
+static atomic_t stream_divider = ATOMIC_INIT(1);
+
+void photodiode_set_stream_divider(uint32_t divider)
+{
+    atomic_set(&stream_divider, divider);
+}
+
+uint32_t photodiode_get_stream_divider(void)
+{
+    return atomic_get(&stream_divider);
+}
+
+
+void photodiode_adc_lock(void)
+{
+    k_mutex_lock(&adc_lock, K_FOREVER);
+}
+
+void photodiode_adc_unlock(void)
+{
+    k_mutex_unlock(&adc_lock);
+}
+
+uint16_t photodiode_fsr_mv(enum pd_channel ch)
+{
+    return gain_fsr_mv[atomic_get(&gain_idx[ch])];
+}
+
+float photodiode_scale(enum pd_channel ch)
+{
+    return (float)gain_fsr_mv[atomic_get(&gain_idx[ch])] / gain_fsr_mv[gain_floor[ch]];
+}
+
+uint8_t photodiode_range(enum pd_channel ch)
+{
+    return atomic_get(&gain_idx[ch]);
+}
+
+float photodiode_normalize(enum pd_channel ch, int16_t sample, uint8_t range)
+{
+    if (sample == INT16_MIN || range >= ARRAY_SIZE(gain_fsr_mv)) {
+        return sample;
+    }
+    return sample * ((float)gain_fsr_mv[range] / gain_fsr_mv[gain_floor[ch]]);
+}
+
+void photodiode_gain_hold(void)
+{
+    atomic_inc(&gain_holds);
+}
+
+void photodiode_gain_release(void)
+{
+    atomic_dec(&gain_holds);
+}
+
+static void gain_init(void)
+{
+    for (int ch = 0; ch < PD_CHANNEL_COUNT; ch++) {
+        gain_floor[ch] = 0;
+        for (size_t i = 0; i < ARRAY_SIZE(gain_ladder); i++) {
+            if (gain_ladder[i] == channel_cfg_dt[ch].gain) {
+                gain_floor[ch] = i;
+                break;
+            }
+        }
+        atomic_set(&gain_idx[ch], gain_floor[ch]);
+    }
+}
+
+/*
+ * Step one range wider as soon as a sample nears full scale; step one
+ * narrower only after CONFIG_APP_PHOTODIODE_AUTORANGE_DWELL samples in a
+ * row would still fit there with headroom. The gap between the two
+ * limits is the hysteresis.
+ */
+static void autorange(enum pd_channel ch, int16_t sample)
+{
+    int idx = atomic_get(&gain_idx[ch]);
+    int32_t mag = abs(sample);
+
+    if (!IS_ENABLED(CONFIG_APP_PHOTODIODE_AUTORANGE) || sample == INT16_MIN ||
+        atomic_get(&gain_holds) > 0) {
+        range_dwell[ch] = 0;
+        return;
+    }
+
+    if (mag >= RANGE_UP_LIMIT && idx > gain_floor[ch]) {
+        atomic_set(&gain_idx[ch], idx - 1);
+        range_dwell[ch] = 0;
+        LOG_DBG("ADC %s range %u mV", channel_names[ch], gain_fsr_mv[idx - 1]);
+        return;
+    }
+
+    if (idx + 1 < (int)ARRAY_SIZE(gain_ladder) &&
+        mag * gain_fsr_mv[idx] / gain_fsr_mv[idx + 1] < RANGE_DOWN_LIMIT) {
+        if (++range_dwell[ch] >= CONFIG_APP_PHOTODIODE_AUTORANGE_DWELL) {
+            atomic_set(&gain_idx[ch], idx + 1);
+            range_dwell[ch] = 0;
+            LOG_DBG("ADC %s range %u mV", channel_names[ch], gain_fsr_mv[idx + 1]);
+        }
+    } else {
+        range_dwell[ch] = 0;
+    }
+}
+
+static void fill_conv(enum pd_channel ch, bool fast, int16_t *sample, struct ads1115_conv *conv)
+{
+    conv->ain = channel_ain[ch];
+    /* The ladder index is the ADS1115 PGA code */
+    conv->pga = atomic_get(&gain_idx[ch]);
+    conv->period_us = fast ? PD_FAST_PERIOD_US
+                           : ADC_ACQ_TIME_VALUE(channel_cfg_dt[ch].acquisition_time);
+    conv->result = sample;
+}
+
+int photodiode_read_channel(enum pd_channel ch, bool fast, int16_t *sample)
+{
+    struct ads1115_conv conv;
+    int rc;
+
+    fill_conv(ch, fast, sample, &conv);
+
+    k_mutex_lock(&adc_lock, K_FOREVER);
+    rc = ads1115_convert(&conv, 1);
+    k_mutex_unlock(&adc_lock);
+
+    if (rc != 0) {
+        LOG_ERR("ADC %s read failed (%d)", channel_names[ch], rc);
+    }
+    return rc;
+}
+
+int photodiode_read_channels(bool fast, int16_t *yj, int16_t *hk)
+{
+    struct ads1115_conv conv[PD_CHANNEL_COUNT];
+    int rc;
+
+    fill_conv(PD_YJ, fast, yj, &conv[PD_YJ]);
+    fill_conv(PD_HK, fast, hk, &conv[PD_HK]);
+
+    k_mutex_lock(&adc_lock, K_FOREVER);
+    rc = ads1115_convert(conv, PD_CHANNEL_COUNT);
+    k_mutex_unlock(&adc_lock);
+
+    if (rc != 0) {
+        LOG_ERR("ADC read failed (%d)", rc);
+    }
+    return rc;
+}
 
 
 void photodiode_thread()
 {
-    int rc_yj, rc_hk;
     int16_t yj_sample, hk_sample;
-    struct adc_sequence seq = {
-        .channels = 0,
-        .buffer = NULL,                        /* We will provide buffer later */
-        .buffer_size = sizeof(int16_t),
-        .resolution = 16,
-        .oversampling=0,
-        .calibrate=false,
-
-    };
 
 	k_sleep(K_MSEC(10));
 
-	while(!device_is_ready(adc_dev)) {
+    supervisor_register(SUPERVISOR_PHOTODIODE);
+    gain_init();
+
+	while(!ads1115_ready()) {
         LOG_ERR("ADS1115 not ready");
 		k_sleep(K_MSEC(10));
+        supervisor_checkin(SUPERVISOR_PHOTODIODE);
     }
 
+    uint32_t count = 0;
+    int64_t slot = k_uptime_get();
+
     while (1) {
 
         int64_t start = k_uptime_get();
 
-		yj_sample = INT16_MIN;
-		hk_sample = INT16_MIN;
+        supervisor_checkin(SUPERVISOR_PHOTODIODE);
 
-        rc_yj = adc_channel_setup(adc_dev, &yj_cfg_dt);
-        if (rc_yj != 0) {
-            LOG_ERR("ADC YJ channel setup failed (%d)", rc_yj);
-        } else {
-            seq.buffer = &yj_sample;
-            rc_yj = adc_read(adc_dev, &seq);
-            if (rc_yj != 0) {
-                LOG_ERR("ADC YJ read failed (%d)", rc_yj);
-            }
-		}
+        uint32_t epoch, digest, epoch_after, digest_after;
+        bool tagged = epoch_current(&epoch, &digest);
+
+        enum pd_channel lockin_ch;
 
-        rc_hk = adc_channel_setup(adc_dev, &hk_cfg_dt);
-        if (rc_hk != 0) {
-            LOG_ERR("ADC HK channel setup failed  (%d)", rc_hk);
+        if (lockin_channel(&lockin_ch)) {
+            /* The other channel gets one quick read; the lock-in the rest */
+            if (lockin_ch == PD_YJ) {
+                (void)photodiode_read_channel(PD_HK, true, &hk_sample);
+                yj_sample = lockin_run(PD_YJ, start + PUBLISH_INTERVAL_MS - LOCKIN_SLACK_MS);
+            } else {
+                (void)photodiode_read_channel(PD_YJ, true, &yj_sample);
+                hk_sample = lockin_run(PD_HK, start + PUBLISH_INTERVAL_MS - LOCKIN_SLACK_MS);
+            }
         } else {
-            seq.buffer = &hk_sample;
-            rc_hk = adc_read(adc_dev, &seq);
-            if (rc_hk != 0) {
-                LOG_ERR("ADC HK read failed (%d)", rc_hk);
+            (void)photodiode_read_channels(false, &yj_sample, &hk_sample);
+        }
+
+        /* Untagged if an actuation overlapped either read */
+        tagged = epoch_current(&epoch_after, &digest_after) && tagged && epoch_after == epoch;
+
+        /* The ranges just read on, before any range change */
+        uint8_t yj_range = photodiode_range(PD_YJ);
+        uint8_t hk_range = photodiode_range(PD_HK);
+
+        /* A lock-in needs its channel's range to stay put */
+        if (!lockin_channel(&lockin_ch) || lockin_ch != PD_YJ) {
+            autorange(PD_YJ, yj_sample);
+        }
+        if (!lockin_channel(&lockin_ch) || lockin_ch != PD_HK) {
+            autorange(PD_HK, hk_sample);
+        }
+
+        /* Raw counts; history normalizes on the way out */
+        history_add((uint32_t)start, yj_sample, hk_sample, yj_range, hk_range);
+
+        uint32_t divider = atomic_get(&stream_divider);
+
+        if (divider != 0 && ++count >= divider) {
+            count = 0;
+
+            // Get timestamp
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+
+            struct OutMsg msg = {0};
+            msg.qos = 0;
+            msg.channel = &photodiode_channel;
+            char epoch_str[40] = "null";
+            float yj = photodiode_normalize(PD_YJ, yj_sample, yj_range);
+            float hk = photodiode_normalize(PD_HK, hk_sample, hk_range);
+
+            if (tagged) {
+                snprintf(epoch_str, sizeof(epoch_str), "%u, \"digest\":\"%08x\"", epoch, digest);
             }
-		}
-
-        // Get timestamp
-        struct timespec ts;
-        clock_gettime(CLOCK_REALTIME, &ts);
-
-        struct OutMsg msg = {0};
-        msg.qos = 0;
-        snprintk(msg.topic, sizeof(msg.topic), "dt/hsfib-tib/photodiode");
-        msg.payload_len = snprintk(msg.payload, sizeof(msg.payload),
-                                  "{\"yj\":%hd, \"hk\":%hd, \"time\":%lld}",
-                                  yj_sample, hk_sample, ts.tv_sec);
-
-        while (k_msgq_put(&photodiode_queue, &msg, K_NO_WAIT) !=0) {
-            /* photodiode_queue is full: purge old data & try again */
-			LOG_WRN("ADC msgq full, purging");
-            k_msgq_purge(&photodiode_queue);
+            msg.payload_len = snprintf(msg.payload, sizeof(msg.payload),
+                                       "{\"yj\":%.2f, \"hk\":%.2f, \"time\":%lld, "
+                                       "\"fsr_mv\":[%u,%u], \"epoch\":%s}",
+                                       (double)yj, (double)hk, ts.tv_sec,
+                                       gain_fsr_mv[yj_range], gain_fsr_mv[hk_range],
+                                       epoch_str);
+
+            /* Straight to the publisher; the oldest sample is dropped if it falls behind */
+            outbound_put(OUT_TELEMETRY, &msg, K_NO_WAIT);
         }
 
-        int64_t elapsed = k_uptime_get() - start;  //overflow every 300M years
-        int64_t remaining = PUBLISH_INTERVAL_MS - elapsed;
+        /* Sleep to an absolute slot so wake-up latency does not accumulate */
+        slot += PUBLISH_INTERVAL_MS;
+        int64_t remaining = slot - k_uptime_get();  //overflow every 300M years
 
         if (remaining > 0) {
-            k_sleep(K_MSEC(remaining));
+            k_sleep(K_TIMEOUT_ABS_MS(slot));
         } else {
-            LOG_WRN("ADC loop overran interval by %lld ms", -remaining);
+            metrics_inc(METRICS_ADC_OVERRUN);
+            TIB_LOG_WRN_RATELIMIT("ADC loop overran interval by %lld ms", -remaining);
+            /* Missed slots are skipped, not sampled back to back */
+            slot = k_uptime_get();
         }
 
     }
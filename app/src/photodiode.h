@@ -6,12 +6,80 @@
 #define PHOTODIODE_H
 
 #include <zephyr/kernel.h>
+#include <coo_commons/mqtt_client.h>
+
+#include "history.h"
 
 #define ADC_RESOLUTION 16  //TODO get this from zephyr,resolution = < 16 >; in the DT
-#define PUBLISH_INTERVAL_MS 20
+#define PHOTODIODE_TOPIC "dt/hsfib-tib/photodiode"
+
+
+/* ADS1115 inputs */
+enum pd_channel {
+    PD_YJ,
+    PD_HK,
+    PD_CHANNEL_COUNT
+};
+
+extern struct coo_mqtt_channel photodiode_channel;
+
+/**
+ * One conversion on @p ch, at the devicetree data rate or, with @p fast,
+ * at 860 SPS. Serialized with every other ADC user.
+ *
+ * @param sample Set to the reading, or INT16_MIN on failure
+ * @return 0 on success, negative error code otherwise
+ */
+int photodiode_read_channel(enum pd_channel ch, bool fast, int16_t *sample);
+
+/**
+ * One conversion on each channel at the devicetree data rate or, with
+ * @p fast, at 860 SPS, queued back to back.
+ *
+ * @return 0 on success, negative error code otherwise; failed samples
+ *         are INT16_MIN
+ */
+int photodiode_read_channels(bool fast, int16_t *yj, int16_t *hk);
+
+/* Hold the ADC across several photodiode_read_channel() calls, pausing
+ * the 50 Hz sampling loop meanwhile
+ */
+void photodiode_adc_lock(void);
+void photodiode_adc_unlock(void);
+
+/*
+ * With CONFIG_APP_PHOTODIODE_AUTORANGE the 50 Hz loop steps each
+ * channel's PGA between the devicetree gain (the widest range it will use)
+ * and +/-256 mV. Every read uses the channel's current range and returns
+ * raw counts; scale by photodiode_scale() to compare across ranges.
+ */
+
+/* Current full-scale range of @p ch, in mV */
+uint16_t photodiode_fsr_mv(enum pd_channel ch);
+
+/* Multiplier from current-range counts to devicetree-range counts */
+float photodiode_scale(enum pd_channel ch);
+
+/* Current range of @p ch as a ladder index, 0 (+/-6.144 V) to 5 (+/-256 mV) */
+uint8_t photodiode_range(enum pd_channel ch);
+
+/* @p sample, read on ladder index @p range, in devicetree-range counts.
+ * INT16_MIN (a failed read) is passed through.
+ */
+float photodiode_normalize(enum pd_channel ch, int16_t sample, uint8_t range);
+
+/* Keep every channel's range fixed while held, for readers comparing
+ * samples over time without holding the ADC. Calls nest.
+ */
+void photodiode_gain_hold(void);
+void photodiode_gain_release(void);
 
+/* Publish every Nth sample on PHOTODIODE_TOPIC (default 1); 0 stops
+ * streaming. Every sample still goes into the history ring.
+ */
+void photodiode_set_stream_divider(uint32_t divider);
+uint32_t photodiode_get_stream_divider(void);
 
-extern struct k_msgq photodiode_queue;
 void photodiode_thread();
 
 #endif //PHOTODIODE_H
@@ -0,0 +1,89 @@
+/*
+ * HiSPEC-TIB least-squares polynomial fit
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include "polyfit.h"
+
+int polyfit_solve(double *m, double *b, int n)
+{
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+
+        for (int row = col + 1; row < n; row++) {
+            if (fabs(m[row * n + col]) > fabs(m[pivot * n + col])) {
+                pivot = row;
+            }
+        }
+        if (fabs(m[pivot * n + col]) < 1e-12) {
+            return -ERANGE;
+        }
+        if (pivot != col) {
+            for (int k = 0; k < n; k++) {
+                double t = m[col * n + k];
+
+                m[col * n + k] = m[pivot * n + k];
+                m[pivot * n + k] = t;
+            }
+            double t = b[col];
+
+            b[col] = b[pivot];
+            b[pivot] = t;
+        }
+        for (int row = col + 1; row < n; row++) {
+            double f = m[row * n + col] / m[col * n + col];
+
+            for (int k = col; k < n; k++) {
+                m[row * n + k] -= f * m[col * n + k];
+            }
+            b[row] -= f * b[col];
+        }
+    }
+
+    for (int row = n - 1; row >= 0; row--) {
+        for (int k = row + 1; k < n; k++) {
+            b[row] -= m[row * n + k] * b[k];
+        }
+        b[row] /= m[row * n + row];
+    }
+    return 0;
+}
+
+int polyfit(const double *x, const double *y, int n, int ncoeffs, double *coeffs)
+{
+    double m[POLYFIT_MAX_COEFFS * POLYFIT_MAX_COEFFS] = {0};
+    double b[POLYFIT_MAX_COEFFS] = {0};
+    int rc;
+
+    if (ncoeffs < 1 || ncoeffs > POLYFIT_MAX_COEFFS) {
+        return -EINVAL;
+    }
+
+    for (int i = 0; i < n; i++) {
+        double xr = 1.0;
+        double pw[2 * POLYFIT_MAX_COEFFS - 1];
+
+        for (int k = 0; k < 2 * ncoeffs - 1; k++) {
+            pw[k] = xr;
+            xr *= x[i];
+        }
+        for (int r = 0; r < ncoeffs; r++) {
+            for (int c = 0; c < ncoeffs; c++) {
+                m[r * ncoeffs + c] += pw[r + c];
+            }
+            b[r] += pw[r] * y[i];
+        }
+    }
+
+    rc = polyfit_solve(m, b, ncoeffs);
+    if (rc == 0) {
+        memcpy(coeffs, b, ncoeffs * sizeof(b[0]));
+    }
+    return rc;
+}
@@ -0,0 +1,31 @@
+/*
+ * HiSPEC-TIB least-squares polynomial fit
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef POLYFIT_H
+#define POLYFIT_H
+
+/* Up to a 4th order polynomial */
+#define POLYFIT_MAX_COEFFS 5
+
+/**
+ * Solve the n x n system m * x = b in place by Gaussian elimination with
+ * partial pivoting. @p m is row-major and destroyed; x is left in @p b.
+ *
+ * @return 0, or -ERANGE if the system is singular
+ */
+int polyfit_solve(double *m, double *b, int n);
+
+/**
+ * Least-squares polynomial through (x[i], y[i]) by the normal equations.
+ *
+ * @param ncoeffs  1 to POLYFIT_MAX_COEFFS, one more than the order
+ * @param coeffs   ncoeffs coefficients, constant term first
+ * @return 0, -EINVAL for a bad ncoeffs, or -ERANGE if the points cannot
+ *         determine the polynomial (e.g. too few distinct x)
+ */
+int polyfit(const double *x, const double *y, int n, int ncoeffs, double *coeffs);
+
+#endif //POLYFIT_H
@@ -0,0 +1,47 @@
+/*
+ * HiSPEC-TIB photodiode-verified route switching
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ROUTE_VERIFY_H
+#define ROUTE_VERIFY_H
+
+#include <zephyr/kernel.h>
+#include <stdint.h>
+
+#include "photodiode.h"
+
+/* Direction of the power change a route switch should produce */
+enum verify_expect {
+    VERIFY_CHANGE,  /* either way */
+    VERIFY_RISE,
+    VERIFY_FALL,
+};
+
+struct verify_result {
+    int16_t before;         /* baseline before the switch */
+    int16_t after;          /* last sample read */
+    uint32_t settle_us;     /* from the start of the switch to a stable new level */
+};
+
+/**
+ * Average a few fast samples of @p ch as the pre-switch baseline.
+ *
+ * @return 0 on success, negative error code if the ADC failed
+ */
+int verify_baseline(enum pd_channel ch, struct verify_result *res);
+
+/**
+ * Sample @p ch at the fastest rate until it has moved at least
+ * CONFIG_APP_ROUTE_VERIFY_THRESHOLD counts from the baseline in the
+ * expected direction and held steady, or until @p timeout_ms after
+ * @p start (a k_cycle_get_32() taken when switching began).
+ *
+ * @return 0 with res->settle_us set, -ETIMEDOUT if no stable transition
+ *         was seen, or a negative ADC error
+ */
+int verify_transition(enum pd_channel ch, enum verify_expect expect, uint32_t start,
+                      uint32_t timeout_ms, struct verify_result *res);
+
+#endif //ROUTE_VERIFY_H
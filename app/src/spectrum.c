@@ -0,0 +1,290 @@
+/*
+ * HiSPEC-TIB photodiode spectral analysis
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Same shape as the transient capture: a dedicated thread owns the ADC
+ * for one block, then does the FFT and publishes without holding it.
+ * Buffers are static; only this thread touches them.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <arm_math.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "spectrum.h"
+#include "outbound.h"
+
+LOG_MODULE_REGISTER(spectrum, CONFIG_APP_LOG_LEVEL);
+
+#define SPECTRUM_STACK_SIZE 1536
+/* Alongside the capture thread, above the 50 Hz loop */
+#define SPECTRUM_PRIORITY   3
+
+#define BLOCK  CONFIG_APP_SPECTRUM_BLOCK
+#define HALF   (BLOCK / 2)
+
+BUILD_ASSERT((BLOCK & (BLOCK - 1)) == 0, "spectrum block must be a power of two");
+BUILD_ASSERT(HALF % CONFIG_APP_SPECTRUM_BINS == 0, "bins must divide the block in half");
+
+/* A block is sampled under the ADC mutex at about 2 ms per sample; the
+ * waiting 50 Hz loop must still meet its watchdog deadline
+ */
+#define MS_PER_SAMPLE 2
+BUILD_ASSERT(BLOCK * MS_PER_SAMPLE < CONFIG_APP_SUPERVISOR_PHOTODIODE_DEADLINE_MS,
+             "spectrum block would outlast the photodiode watchdog deadline");
+
+/* Peak search skips the bins the Hann window smears DC into */
+#define FIRST_PEAK_BIN 2
+
+static K_SEM_DEFINE(start_sem, 0, 1);
+static atomic_t busy;
+static atomic_t stop;
+
+static enum pd_channel spec_ch;
+static uint8_t spec_peaks;
+static uint32_t spec_period_s;
+static uint8_t spec_corr[MAX_CORRELATION_DATA];
+static size_t spec_corr_len;
+
+static int16_t samples[BLOCK];
+static float32_t buf[BLOCK];
+static float32_t freq[BLOCK];
+static float32_t mag[HALF];
+static arm_rfft_fast_instance_f32 rfft;
+static struct OutMsg msg;
+
+struct peak {
+    float f;
+    float a;
+};
+
+int spectrum_start(enum pd_channel ch, uint8_t peaks, uint32_t period_s,
+                   const struct Command *cmd)
+{
+    if (!atomic_cas(&busy, 0, 1)) {
+        return -EBUSY;
+    }
+
+    spec_ch = ch;
+    spec_peaks = MIN(peaks, SPECTRUM_MAX_PEAKS);
+    spec_period_s = period_s;
+    spec_corr_len = MIN(cmd->corr_len, sizeof(spec_corr));
+    memcpy(spec_corr, cmd->correlation_data, spec_corr_len);
+    atomic_clear(&stop);
+
+    k_sem_give(&start_sem);
+    return 0;
+}
+
+void spectrum_stop(void)
+{
+    if (!atomic_get(&busy)) {
+        return;
+    }
+    atomic_set(&stop, 1);
+    /* Wake a periodic run waiting for its next block */
+    k_sem_give(&start_sem);
+}
+
+/* Sample one block; returns the achieved sample rate */
+static float sample_block(void)
+{
+    uint32_t start;
+    uint64_t elapsed_ns;
+
+    photodiode_adc_lock();
+    start = k_cycle_get_32();
+    for (int i = 0; i < BLOCK; i++) {
+        (void)photodiode_read_channel(spec_ch, true, &samples[i]);
+    }
+    elapsed_ns = k_cyc_to_ns_floor64(k_cycle_get_32() - start);
+    photodiode_adc_unlock();
+
+    return elapsed_ns > 0 ? BLOCK * 1e9f / (float)elapsed_ns : 0.0f;
+}
+
+/* Windowed FFT into mag[] as sinusoid amplitude in counts; returns the mean */
+static float analyse(void)
+{
+    float32_t mean = 0.0f;
+    int valid = 0;
+
+    for (int i = 0; i < BLOCK; i++) {
+        if (samples[i] != INT16_MIN) {
+            mean += samples[i];
+            valid++;
+        }
+    }
+    mean = valid > 0 ? mean / valid : 0.0f;
+
+    /* Failed reads become the mean, contributing nothing */
+    for (int i = 0; i < BLOCK; i++) {
+        float32_t x = samples[i] != INT16_MIN ? samples[i] - mean : 0.0f;
+        float32_t w = 0.5f - 0.5f * arm_cos_f32(2.0f * PI * i / BLOCK);
+
+        buf[i] = x * w;
+    }
+
+    arm_rfft_fast_f32(&rfft, buf, freq, 0);
+    /* freq[1] holds the Nyquist bin's real part; leave it out */
+    freq[1] = 0.0f;
+    arm_cmplx_mag_f32(freq, mag, HALF);
+
+    /* A Hann-windowed sinusoid of amplitude A peaks at A * BLOCK / 4 */
+    arm_scale_f32(mag, 4.0f / BLOCK, mag, HALF);
+
+    return mean;
+}
+
+static int find_peaks(float fs, struct peak *peaks, int max)
+{
+    int n = 0;
+
+    for (int k = FIRST_PEAK_BIN; k < HALF - 1; k++) {
+        if (mag[k] <= mag[k - 1] || mag[k] < mag[k + 1]) {
+            continue;
+        }
+
+        /* Keep the list sorted by amplitude, largest first */
+        int pos = n;
+
+        while (pos > 0 && peaks[pos - 1].a < mag[k]) {
+            pos--;
+        }
+        if (pos >= max) {
+            continue;
+        }
+        if (n < max) {
+            n++;
+        }
+        memmove(&peaks[pos + 1], &peaks[pos], (n - 1 - pos) * sizeof(peaks[0]));
+
+        /* Parabolic interpolation on log amplitude */
+        float l = logf(mag[k - 1] + 1e-9f);
+        float c = logf(mag[k] + 1e-9f);
+        float r = logf(mag[k + 1] + 1e-9f);
+        float denom = l - 2.0f * c + r;
+        float delta = denom != 0.0f ? 0.5f * (l - r) / denom : 0.0f;
+
+        peaks[pos].f = (k + delta) * fs / BLOCK;
+        peaks[pos].a = mag[k];
+    }
+    return n;
+}
+
+static int format_result(char *buf_out, size_t len, float fs, float mean,
+                         const struct peak *peaks, int n_peaks)
+{
+    size_t offset;
+    int written;
+
+    written = snprintf(buf_out, len, "{\"ch\":\"%s\",\"fs\":%.1f,\"df\":%.3f,\"n\":%d,"
+                       "\"dc\":%.1f,\"fsr_mv\":%u,\"db\":[", spec_ch == PD_HK ? "hk" : "yj",
+                       (double)fs, (double)(fs / BLOCK), BLOCK, (double)mean,
+                       photodiode_fsr_mv(spec_ch));
+    if (written < 0 || written >= (int)len) {
+        return -ENOMEM;
+    }
+    offset = written;
+
+    for (int b = 0; b < CONFIG_APP_SPECTRUM_BINS; b++) {
+        const int width = HALF / CONFIG_APP_SPECTRUM_BINS;
+        float32_t band_max;
+        uint32_t idx;
+
+        arm_max_f32(&mag[b * width], width, &band_max, &idx);
+        written = snprintf(buf_out + offset, len - offset, "%s%d", b > 0 ? "," : "",
+                           (int)lroundf(20.0f * log10f(MAX(band_max, 1e-3f))));
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+
+    written = snprintf(buf_out + offset, len - offset, "],\"peaks\":[");
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    offset += written;
+
+    for (int i = 0; i < n_peaks; i++) {
+        written = snprintf(buf_out + offset, len - offset, "%s{\"f\":%.2f,\"a\":%.2f}",
+                           i > 0 ? "," : "", (double)peaks[i].f, (double)peaks[i].a);
+        if (written < 0 || written >= (int)(len - offset)) {
+            return -ENOMEM;
+        }
+        offset += written;
+    }
+
+    written = snprintf(buf_out + offset, len - offset, "]}");
+    if (written < 0 || written >= (int)(len - offset)) {
+        return -ENOMEM;
+    }
+    return offset + written;
+}
+
+static void publish(float fs, float mean)
+{
+    struct peak peaks[SPECTRUM_MAX_PEAKS];
+    int n_peaks = find_peaks(fs, peaks, spec_peaks);
+    int len;
+
+    memset(&msg, 0, sizeof(msg));
+    strncpy(msg.topic, SPECTRUM_TOPIC, sizeof(msg.topic) - 1);
+    msg.msg_type = RESP_OK;
+    msg.qos = MQTT_QOS_1_AT_LEAST_ONCE;
+
+    /* Drop the smallest peaks rather than the whole spectrum */
+    do {
+        len = format_result(msg.payload, sizeof(msg.payload), fs, mean, peaks, n_peaks);
+    } while (len < 0 && n_peaks-- > 0);
+    if (len < 0) {
+        LOG_ERR("Spectrum does not fit in one publish");
+        return;
+    }
+    msg.payload_len = len;
+
+    memcpy(msg.correlation_data, spec_corr, spec_corr_len);
+    msg.corr_len = spec_corr_len;
+
+    if (outbound_put(OUT_RESPONSE, &msg, K_SECONDS(1)) != 0) {
+        LOG_WRN("Spectrum dropped: response queue full");
+    }
+}
+
+static void spectrum_thread(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1); ARG_UNUSED(p2); ARG_UNUSED(p3);
+
+    if (arm_rfft_fast_init_f32(&rfft, BLOCK) != ARM_MATH_SUCCESS) {
+        LOG_ERR("No FFT for a %d-sample block", BLOCK);
+        return;
+    }
+
+    while (1) {
+        k_sem_take(&start_sem, K_FOREVER);
+
+        do {
+            if (atomic_get(&stop)) {
+                break;
+            }
+
+            float fs = sample_block();
+            float mean = analyse();
+
+            publish(fs, mean);
+            LOG_DBG("Spectrum of %d samples at %.1f SPS", BLOCK, (double)fs);
+        } while (spec_period_s > 0 &&
+                 k_sem_take(&start_sem, K_SECONDS(spec_period_s)) == -EAGAIN);
+
+        atomic_clear(&busy);
+    }
+}
+
+K_THREAD_DEFINE(spectrum_tid, SPECTRUM_STACK_SIZE,
+                spectrum_thread, NULL, NULL, NULL,
+                SPECTRUM_PRIORITY, 0, 0);
@@ -0,0 +1,60 @@
+/*
+ * HiSPEC-TIB photodiode spectral analysis
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <zephyr/kernel.h>
+
+#include "command.h"
+#include "photodiode.h"
+
+#define SPECTRUM_TOPIC "dt/hsfib-tib/spectrum"
+
+/* Most peaks a request may ask for */
+#define SPECTRUM_MAX_PEAKS 8
+/* Shortest repeat; each block keeps the 50 Hz loop off the ADC */
+#define SPECTRUM_MIN_PERIOD_S 5
+
+/*
+ * Each analysis samples one channel at the ADC's fastest rate for
+ * CONFIG_APP_SPECTRUM_BLOCK samples, removes the mean, applies a Hann
+ * window and takes a real FFT. Published on SPECTRUM_TOPIC:
+ *
+ *   {"ch":"yj","fs":843.2,"df":1.647,"n":512,"dc":1203.4,
+ *    "db":[...],"peaks":[{"f":50.02,"a":3.41},...]}
+ *
+ * "db" is the amplitude spectrum, max-pooled to CONFIG_APP_SPECTRUM_BINS
+ * bands, in whole dB relative to one ADC count. Peaks are the largest
+ * local maxima, amplitude in counts, frequency interpolated between bins.
+ */
+
+/**
+ * Analyse @p ch once, or every @p period_s seconds until stopped, on the
+ * spectrum thread. The 50 Hz loop pauses while a block is sampled.
+ *
+ * @param cmd  Command whose correlation data tags the results
+ * @return 0 if started, -EBUSY if an analysis is being sampled
+ */
+#if defined(CONFIG_APP_SPECTRUM)
+int spectrum_start(enum pd_channel ch, uint8_t peaks, uint32_t period_s,
+                   const struct Command *cmd);
+
+/** Stop periodic analysis after the current block */
+void spectrum_stop(void);
+#else
+static inline int spectrum_start(enum pd_channel ch, uint8_t peaks, uint32_t period_s,
+                                 const struct Command *cmd)
+{
+    return -ENOTSUP;
+}
+
+static inline void spectrum_stop(void)
+{
+}
+#endif
+
+#endif //SPECTRUM_H
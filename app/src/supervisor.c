@@ -0,0 +1,115 @@
+/*
+ * HiSPEC-TIB thread supervisor
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * One task watchdog channel per critical thread. The task watchdog feeds
+ * the hardware watchdog from a kernel timer as long as no channel has
+ * expired, so a stuck thread resets the board while a thread that is
+ * merely waiting on the network, with check-ins, does not.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/init.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/logging/log_ctrl.h>
+#include <zephyr/sys/reboot.h>
+#include <zephyr/task_wdt/task_wdt.h>
+
+#include "supervisor.h"
+
+LOG_MODULE_REGISTER(supervisor, CONFIG_APP_LOG_LEVEL);
+
+struct supervised {
+    const char *name;
+    uint32_t deadline_ms;
+    int channel;            /* task watchdog channel, -1 until registered */
+    k_tid_t thread;
+    atomic_t last_checkin;  /* k_uptime_get_32() */
+};
+
+static struct supervised tasks[SUPERVISOR_TASK_COUNT] = {
+    [SUPERVISOR_MQTT] = {
+        .name = "mqtt", .deadline_ms = CONFIG_APP_SUPERVISOR_MQTT_DEADLINE_MS, .channel = -1,
+    },
+    [SUPERVISOR_EXECUTOR] = {
+        .name = "executor", .deadline_ms = CONFIG_APP_SUPERVISOR_EXECUTOR_DEADLINE_MS,
+        .channel = -1,
+    },
+    [SUPERVISOR_PHOTODIODE] = {
+        .name = "photodiode", .deadline_ms = CONFIG_APP_SUPERVISOR_PHOTODIODE_DEADLINE_MS,
+        .channel = -1,
+    },
+};
+
+static void expired(int channel_id, void *user_data)
+{
+    const struct supervised *task = user_data;
+
+    ARG_UNUSED(channel_id);
+
+    LOG_ERR("Thread %s missed its %u ms deadline, rebooting", task->name, task->deadline_ms);
+    LOG_PANIC();
+    sys_reboot(SYS_REBOOT_COLD);
+}
+
+int supervisor_register(enum supervisor_task task)
+{
+    struct supervised *t = &tasks[task];
+    int channel;
+
+    channel = task_wdt_add(t->deadline_ms, expired, t);
+    if (channel < 0) {
+        LOG_ERR("No watchdog channel for %s (%d)", t->name, channel);
+        return channel;
+    }
+
+    t->thread = k_current_get();
+    atomic_set(&t->last_checkin, k_uptime_get_32());
+    t->channel = channel;
+    return 0;
+}
+
+void supervisor_checkin(enum supervisor_task task)
+{
+    struct supervised *t = &tasks[task];
+
+    if (t->channel < 0) {
+        return;
+    }
+    atomic_set(&t->last_checkin, k_uptime_get_32());
+    (void)task_wdt_feed(t->channel);
+}
+
+int64_t supervisor_checkin_age(k_tid_t thread)
+{
+    for (int i = 0; i < ARRAY_SIZE(tasks); i++) {
+        if (tasks[i].channel >= 0 && tasks[i].thread == thread) {
+            return (uint32_t)(k_uptime_get_32() - (uint32_t)atomic_get(&tasks[i].last_checkin));
+        }
+    }
+    return -1;
+}
+
+/* Runs before static threads start, so they can register right away */
+static int supervisor_init(void)
+{
+    const struct device *hw_wdt = DEVICE_DT_GET_OR_NULL(DT_ALIAS(watchdog0));
+    int rc;
+
+    if (hw_wdt != NULL && !device_is_ready(hw_wdt)) {
+        hw_wdt = NULL;
+    }
+    if (hw_wdt == NULL) {
+        LOG_WRN("Watchdog device not available - supervising in software only");
+    }
+
+    rc = task_wdt_init(hw_wdt);
+    if (rc != 0) {
+        LOG_ERR("Task watchdog init failed (%d)", rc);
+    }
+    return 0;
+}
+
+SYS_INIT(supervisor_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,41 @@
+/*
+ * HiSPEC-TIB thread supervisor
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <zephyr/kernel.h>
+
+/* Supervised threads */
+enum supervisor_task {
+    SUPERVISOR_MQTT,        /* main thread: connect, publish, process */
+    SUPERVISOR_EXECUTOR,    /* command dispatch, including Modbus transactions */
+    SUPERVISOR_PHOTODIODE,  /* ADC sampling loop */
+    SUPERVISOR_TASK_COUNT
+};
+
+/**
+ * Put the calling thread under supervision. It must then call
+ * supervisor_checkin() at least every CONFIG_APP_SUPERVISOR_*_DEADLINE_MS,
+ * otherwise the failure is logged and the board reboots. The hardware
+ * watchdog is fed only while every registered thread meets its deadline.
+ *
+ * @return 0 on success, negative error code if no task watchdog channel
+ *         is available
+ */
+int supervisor_register(enum supervisor_task task);
+
+/** Report that the calling thread is alive */
+void supervisor_checkin(enum supervisor_task task);
+
+/**
+ * Milliseconds since @p thread last checked in.
+ *
+ * @return the age, or -1 if the thread is not supervised
+ */
+int64_t supervisor_checkin_age(k_tid_t thread);
+
+#endif //SUPERVISOR_H
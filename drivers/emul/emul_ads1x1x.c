@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT ti_ads1115
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <app/drivers/tib_emul.h>
+
+LOG_MODULE_REGISTER(emul_ads1x1x, CONFIG_APP_EMUL_LOG_LEVEL);
+
+#define ADS1X1X_REG_CONV     0x00
+#define ADS1X1X_REG_CONFIG   0x01
+#define ADS1X1X_REG_LO_THRESH 0x02
+#define ADS1X1X_REG_HI_THRESH 0x03
+#define ADS1X1X_NUM_REGS     4
+
+#define ADS1X1X_CONFIG_OS        BIT(15)
+#define ADS1X1X_CONFIG_MUX(reg)  (((reg) >> 12) & 0x7)
+#define ADS1X1X_CONFIG_PGA(reg)  (((reg) >> 9) & 0x7)
+#define ADS1X1X_CONFIG_MODE      BIT(8)
+#define ADS1X1X_CONFIG_DEFAULT   0x8583
+
+#define ADS1X1X_NUM_INPUTS 4
+
+struct ads1x1x_emul_data {
+	struct k_spinlock lock;
+	uint16_t regs[ADS1X1X_NUM_REGS];
+	uint8_t pointer;
+	int32_t input_uv[ADS1X1X_NUM_INPUTS];
+	uint32_t conversions;
+};
+
+struct ads1x1x_emul_cfg {
+	uint16_t addr;
+};
+
+/* Full-scale range in microvolts for each PGA setting */
+static const int32_t pga_fsr_uv[8] = {
+	6144000, 4096000, 2048000, 1024000, 512000, 256000, 256000, 256000,
+};
+
+static int32_t mux_voltage(const struct ads1x1x_emul_data *data, uint8_t mux)
+{
+	const int32_t *in = data->input_uv;
+
+	switch (mux) {
+	case 0: return in[0] - in[1];
+	case 1: return in[0] - in[3];
+	case 2: return in[1] - in[3];
+	case 3: return in[2] - in[3];
+	default: return in[mux - 4];
+	}
+}
+
+/* Called with the lock held */
+static void ads1x1x_emul_convert(struct ads1x1x_emul_data *data)
+{
+	uint16_t config = data->regs[ADS1X1X_REG_CONFIG];
+	int64_t uv = mux_voltage(data, ADS1X1X_CONFIG_MUX(config));
+	int64_t code = (uv * 32768) / pga_fsr_uv[ADS1X1X_CONFIG_PGA(config)];
+
+	code = CLAMP(code, INT16_MIN, INT16_MAX);
+	data->regs[ADS1X1X_REG_CONV] = (uint16_t)(int16_t)code;
+	data->conversions++;
+}
+
+static void ads1x1x_emul_write_reg(struct ads1x1x_emul_data *data, uint8_t reg, uint16_t val)
+{
+	switch (reg) {
+	case ADS1X1X_REG_CONFIG:
+		data->regs[reg] = val;
+		/* Single-shot start or continuous mode: the result is ready immediately */
+		if ((val & ADS1X1X_CONFIG_OS) || !(val & ADS1X1X_CONFIG_MODE)) {
+			ads1x1x_emul_convert(data);
+		}
+		/* OS reads back as 1 when no conversion is in progress */
+		data->regs[reg] |= ADS1X1X_CONFIG_OS;
+		break;
+	case ADS1X1X_REG_LO_THRESH:
+	case ADS1X1X_REG_HI_THRESH:
+		data->regs[reg] = val;
+		break;
+	default:
+		/* Conversion register is read-only */
+		break;
+	}
+}
+
+static int ads1x1x_emul_transfer(const struct emul *target, struct i2c_msg *msgs,
+				 int num_msgs, int addr)
+{
+	struct ads1x1x_emul_data *data = target->data;
+	k_spinlock_key_t key;
+	int rc = 0;
+
+	key = k_spin_lock(&data->lock);
+
+	for (int i = 0; i < num_msgs; i++) {
+		struct i2c_msg *msg = &msgs[i];
+
+		if ((msg->flags & I2C_MSG_RW_MASK) == I2C_MSG_WRITE) {
+			if (msg->len < 1) {
+				rc = -EIO;
+				break;
+			}
+			if (msg->buf[0] >= ADS1X1X_NUM_REGS) {
+				LOG_ERR("Invalid register pointer 0x%02x", msg->buf[0]);
+				rc = -EIO;
+				break;
+			}
+			data->pointer = msg->buf[0];
+			if (msg->len == 3) {
+				ads1x1x_emul_write_reg(data, data->pointer,
+						       sys_get_be16(&msg->buf[1]));
+			} else if (msg->len != 1) {
+				rc = -EIO;
+				break;
+			}
+		} else {
+			if (msg->len != 2) {
+				rc = -EIO;
+				break;
+			}
+			sys_put_be16(data->regs[data->pointer], msg->buf);
+		}
+	}
+
+	k_spin_unlock(&data->lock, key);
+
+	return rc;
+}
+
+static const struct i2c_emul_api ads1x1x_emul_api = {
+	.transfer = ads1x1x_emul_transfer,
+};
+
+int tib_emul_ads1x1x_set_input(const struct emul *target, uint8_t ain, int32_t microvolts)
+{
+	struct ads1x1x_emul_data *data = target->data;
+	k_spinlock_key_t key;
+
+	if (ain >= ADS1X1X_NUM_INPUTS) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&data->lock);
+	data->input_uv[ain] = microvolts;
+	k_spin_unlock(&data->lock, key);
+
+	return 0;
+}
+
+uint32_t tib_emul_ads1x1x_conversions(const struct emul *target)
+{
+	struct ads1x1x_emul_data *data = target->data;
+
+	return data->conversions;
+}
+
+static int ads1x1x_emul_init(const struct emul *target, const struct device *parent)
+{
+	struct ads1x1x_emul_data *data = target->data;
+
+	ARG_UNUSED(parent);
+
+	data->regs[ADS1X1X_REG_CONV] = 0;
+	data->regs[ADS1X1X_REG_CONFIG] = ADS1X1X_CONFIG_DEFAULT;
+	data->regs[ADS1X1X_REG_LO_THRESH] = 0x8000;
+	data->regs[ADS1X1X_REG_HI_THRESH] = 0x7fff;
+	data->pointer = ADS1X1X_REG_CONV;
+
+	return 0;
+}
+
+#define ADS1X1X_EMUL(n)								\
+	static struct ads1x1x_emul_data ads1x1x_emul_data_##n;			\
+	static const struct ads1x1x_emul_cfg ads1x1x_emul_cfg_##n = {		\
+		.addr = DT_INST_REG_ADDR(n),					\
+	};									\
+	EMUL_DT_INST_DEFINE(n, ads1x1x_emul_init, &ads1x1x_emul_data_##n,	\
+			    &ads1x1x_emul_cfg_##n, &ads1x1x_emul_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(ADS1X1X_EMUL)
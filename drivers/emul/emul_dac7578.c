@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT ti_dac7578
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+#include <app/drivers/tib_emul.h>
+
+LOG_MODULE_REGISTER(emul_dac7578, CONFIG_APP_EMUL_LOG_LEVEL);
+
+/* Command nibble of the command/access byte */
+#define DAC7578_CMD_WRITE          0x0
+#define DAC7578_CMD_UPDATE         0x1
+#define DAC7578_CMD_WRITE_UPD_ALL  0x2
+#define DAC7578_CMD_WRITE_UPDATE   0x3
+#define DAC7578_CMD_RESET          0x7
+
+#define DAC7578_ADDR_ALL   0xf
+#define DAC7578_NUM_CHANNELS 8
+
+struct dac7578_emul_data {
+	struct k_spinlock lock;
+	uint16_t input[DAC7578_NUM_CHANNELS];
+	uint16_t output[DAC7578_NUM_CHANNELS];
+	uint8_t command;
+};
+
+struct dac7578_emul_cfg {
+	uint16_t addr;
+};
+
+/* Called with the lock held */
+static void dac7578_emul_command(struct dac7578_emul_data *data, uint8_t cmd_byte, uint16_t code)
+{
+	uint8_t cmd = cmd_byte >> 4;
+	uint8_t addr = cmd_byte & 0xf;
+
+	for (uint8_t ch = 0; ch < DAC7578_NUM_CHANNELS; ch++) {
+		if (addr != DAC7578_ADDR_ALL && addr != ch) {
+			continue;
+		}
+
+		switch (cmd) {
+		case DAC7578_CMD_WRITE:
+			data->input[ch] = code;
+			break;
+		case DAC7578_CMD_UPDATE:
+			data->output[ch] = data->input[ch];
+			break;
+		case DAC7578_CMD_WRITE_UPD_ALL:
+		case DAC7578_CMD_WRITE_UPDATE:
+			data->input[ch] = code;
+			data->output[ch] = code;
+			break;
+		case DAC7578_CMD_RESET:
+			data->input[ch] = 0;
+			data->output[ch] = 0;
+			break;
+		default:
+			/* Power-down, clear-code and LDAC registers are not modelled */
+			break;
+		}
+	}
+
+	if (cmd == DAC7578_CMD_WRITE_UPD_ALL) {
+		memcpy(data->output, data->input, sizeof(data->output));
+	}
+}
+
+static int dac7578_emul_transfer(const struct emul *target, struct i2c_msg *msgs,
+				 int num_msgs, int addr)
+{
+	struct dac7578_emul_data *data = target->data;
+	k_spinlock_key_t key;
+	int rc = 0;
+
+	key = k_spin_lock(&data->lock);
+
+	for (int i = 0; i < num_msgs; i++) {
+		struct i2c_msg *msg = &msgs[i];
+
+		if ((msg->flags & I2C_MSG_RW_MASK) == I2C_MSG_WRITE) {
+			if (msg->len == 1) {
+				/* Command byte only: selects the register for a read-back */
+				data->command = msg->buf[0];
+			} else if (msg->len == 3) {
+				data->command = msg->buf[0];
+				/* 12-bit code is left-justified in the two data bytes */
+				dac7578_emul_command(data, msg->buf[0],
+						     sys_get_be16(&msg->buf[1]) >> 4);
+			} else {
+				rc = -EIO;
+				break;
+			}
+		} else {
+			uint8_t ch = data->command & 0xf;
+			uint16_t code;
+
+			if (msg->len != 2 || ch >= DAC7578_NUM_CHANNELS) {
+				rc = -EIO;
+				break;
+			}
+			code = (data->command >> 4) == DAC7578_CMD_WRITE ?
+				data->input[ch] : data->output[ch];
+			sys_put_be16(code << 4, msg->buf);
+		}
+	}
+
+	k_spin_unlock(&data->lock, key);
+
+	return rc;
+}
+
+static const struct i2c_emul_api dac7578_emul_api = {
+	.transfer = dac7578_emul_transfer,
+};
+
+int tib_emul_dac7578_get_code(const struct emul *target, uint8_t channel, uint16_t *code)
+{
+	struct dac7578_emul_data *data = target->data;
+
+	if (channel >= DAC7578_NUM_CHANNELS) {
+		return -EINVAL;
+	}
+
+	*code = data->output[channel];
+	return 0;
+}
+
+static int dac7578_emul_init(const struct emul *target, const struct device *parent)
+{
+	struct dac7578_emul_data *data = target->data;
+
+	ARG_UNUSED(parent);
+
+	memset(data->input, 0, sizeof(data->input));
+	memset(data->output, 0, sizeof(data->output));
+
+	return 0;
+}
+
+#define DAC7578_EMUL(n)								\
+	static struct dac7578_emul_data dac7578_emul_data_##n;			\
+	static const struct dac7578_emul_cfg dac7578_emul_cfg_##n = {		\
+		.addr = DT_INST_REG_ADDR(n),					\
+	};									\
+	EMUL_DT_INST_DEFINE(n, dac7578_emul_init, &dac7578_emul_data_##n,	\
+			    &dac7578_emul_cfg_##n, &dac7578_emul_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(DAC7578_EMUL)
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT nxp_pcal6416a
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+
+#include <app/drivers/tib_emul.h>
+
+LOG_MODULE_REGISTER(emul_pcal64xxa, CONFIG_APP_EMUL_LOG_LEVEL);
+
+#define PCAL6416A_REG_INPUT       0x00
+#define PCAL6416A_REG_OUTPUT      0x02
+#define PCAL6416A_REG_CONFIG      0x06
+#define PCAL6416A_REG_INT_MASK    0x4a
+#define PCAL6416A_REG_INT_STATUS  0x4c
+#define PCAL6416A_REG_LAST        0x4f
+#define PCAL6416A_NUM_REGS        (PCAL6416A_REG_LAST + 1)
+
+#define PCAL6416A_NUM_PINS 16
+
+struct pcal64xxa_emul_data {
+	struct k_spinlock lock;
+	uint8_t regs[PCAL6416A_NUM_REGS];
+	uint8_t pointer;
+	uint16_t external_input;
+	uint32_t pulses[PCAL6416A_NUM_PINS];
+};
+
+struct pcal64xxa_emul_cfg {
+	uint16_t addr;
+};
+
+static inline uint16_t get_reg16(const struct pcal64xxa_emul_data *data, uint8_t reg)
+{
+	return data->regs[reg] | (data->regs[reg + 1] << 8);
+}
+
+/* Called with the lock held */
+static void pcal64xxa_emul_update_input(struct pcal64xxa_emul_data *data)
+{
+	uint16_t config = get_reg16(data, PCAL6416A_REG_CONFIG);
+	uint16_t output = get_reg16(data, PCAL6416A_REG_OUTPUT);
+	uint16_t input = (output & ~config) | (data->external_input & config);
+
+	data->regs[PCAL6416A_REG_INPUT] = input & 0xff;
+	data->regs[PCAL6416A_REG_INPUT + 1] = input >> 8;
+}
+
+/* Called with the lock held */
+static void pcal64xxa_emul_write_reg(struct pcal64xxa_emul_data *data, uint8_t reg, uint8_t val)
+{
+	if (reg < PCAL6416A_REG_OUTPUT || reg == PCAL6416A_REG_INT_STATUS ||
+	    reg == PCAL6416A_REG_INT_STATUS + 1) {
+		/* Input port and interrupt status are read-only */
+		return;
+	}
+
+	if (reg == PCAL6416A_REG_OUTPUT || reg == PCAL6416A_REG_OUTPUT + 1) {
+		uint8_t shift = (reg - PCAL6416A_REG_OUTPUT) * 8;
+		uint8_t config = data->regs[PCAL6416A_REG_CONFIG + (reg - PCAL6416A_REG_OUTPUT)];
+		uint8_t rising = val & ~data->regs[reg] & ~config;
+
+		for (uint8_t bit = 0; bit < 8; bit++) {
+			if (rising & BIT(bit)) {
+				data->pulses[shift + bit]++;
+			}
+		}
+	}
+
+	data->regs[reg] = val;
+	pcal64xxa_emul_update_input(data);
+}
+
+static int pcal64xxa_emul_transfer(const struct emul *target, struct i2c_msg *msgs,
+				   int num_msgs, int addr)
+{
+	struct pcal64xxa_emul_data *data = target->data;
+	k_spinlock_key_t key;
+	int rc = 0;
+
+	key = k_spin_lock(&data->lock);
+
+	for (int i = 0; i < num_msgs && rc == 0; i++) {
+		struct i2c_msg *msg = &msgs[i];
+
+		if ((msg->flags & I2C_MSG_RW_MASK) == I2C_MSG_WRITE) {
+			if (msg->len < 1 || msg->buf[0] >= PCAL6416A_NUM_REGS) {
+				rc = -EIO;
+				break;
+			}
+			data->pointer = msg->buf[0];
+			for (uint32_t j = 1; j < msg->len; j++) {
+				if (data->pointer >= PCAL6416A_NUM_REGS) {
+					rc = -EIO;
+					break;
+				}
+				pcal64xxa_emul_write_reg(data, data->pointer++, msg->buf[j]);
+			}
+		} else {
+			for (uint32_t j = 0; j < msg->len; j++) {
+				if (data->pointer >= PCAL6416A_NUM_REGS) {
+					rc = -EIO;
+					break;
+				}
+				msg->buf[j] = data->regs[data->pointer++];
+			}
+		}
+	}
+
+	k_spin_unlock(&data->lock, key);
+
+	return rc;
+}
+
+static const struct i2c_emul_api pcal64xxa_emul_api = {
+	.transfer = pcal64xxa_emul_transfer,
+};
+
+int tib_emul_pcal64xxa_get_output(const struct emul *target, uint8_t pin)
+{
+	struct pcal64xxa_emul_data *data = target->data;
+
+	if (pin >= PCAL6416A_NUM_PINS) {
+		return -EINVAL;
+	}
+
+	return (get_reg16(data, PCAL6416A_REG_OUTPUT) >> pin) & 1;
+}
+
+uint32_t tib_emul_pcal64xxa_pulses(const struct emul *target, uint8_t pin)
+{
+	struct pcal64xxa_emul_data *data = target->data;
+
+	if (pin >= PCAL6416A_NUM_PINS) {
+		return 0;
+	}
+
+	return data->pulses[pin];
+}
+
+static int pcal64xxa_emul_init(const struct emul *target, const struct device *parent)
+{
+	struct pcal64xxa_emul_data *data = target->data;
+
+	ARG_UNUSED(parent);
+
+	/* Power-on defaults: outputs high, all pins inputs, interrupts masked */
+	memset(data->regs, 0, sizeof(data->regs));
+	data->regs[PCAL6416A_REG_OUTPUT] = 0xff;
+	data->regs[PCAL6416A_REG_OUTPUT + 1] = 0xff;
+	data->regs[PCAL6416A_REG_CONFIG] = 0xff;
+	data->regs[PCAL6416A_REG_CONFIG + 1] = 0xff;
+	data->regs[PCAL6416A_REG_INT_MASK] = 0xff;
+	data->regs[PCAL6416A_REG_INT_MASK + 1] = 0xff;
+	pcal64xxa_emul_update_input(data);
+
+	return 0;
+}
+
+#define PCAL64XXA_EMUL(n)							\
+	static struct pcal64xxa_emul_data pcal64xxa_emul_data_##n;		\
+	static const struct pcal64xxa_emul_cfg pcal64xxa_emul_cfg_##n = {	\
+		.addr = DT_INST_REG_ADDR(n),					\
+	};									\
+	EMUL_DT_INST_DEFINE(n, pcal64xxa_emul_init, &pcal64xxa_emul_data_##n,	\
+			    &pcal64xxa_emul_cfg_##n, &pcal64xxa_emul_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(PCAL64XXA_EMUL)
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_DRIVERS_TIB_EMUL_H_
+#define APP_DRIVERS_TIB_EMUL_H_
+
+#include <zephyr/drivers/emul.h>
+#include <stdint.h>
+
+/**
+ * @defgroup drivers_tib_emul TIB peripheral emulators
+ * @ingroup drivers
+ * @{
+ *
+ * @brief Backend API of the I2C emulators used for native_sim builds
+ *
+ * The emulators sit behind the Zephyr PCAL6416A and DAC7578 drivers and
+ * behind either the Zephyr ADS1x1x driver or the application's own RTIO
+ * path to the ADS1115, and model the registers those touch. The
+ * functions below let tests and harness code inject photodiode voltages and
+ * observe what the application drove onto the MEMS switches and attenuators.
+ */
+
+/**
+ * @brief Set the voltage applied to one ADS1115 input.
+ *
+ * @param target Emulator instance (e.g. EMUL_DT_GET(DT_NODELABEL(adc1115))).
+ * @param ain Analog input 0..3.
+ * @param microvolts Input voltage relative to GND.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if @p ain is out of range.
+ */
+int tib_emul_ads1x1x_set_input(const struct emul *target, uint8_t ain, int32_t microvolts);
+
+/**
+ * @brief Get the number of conversions performed by the ADS1115 emulator.
+ *
+ * @param target Emulator instance.
+ * @return Conversions started since boot.
+ */
+uint32_t tib_emul_ads1x1x_conversions(const struct emul *target);
+
+/**
+ * @brief Get the current output level of a PCAL6416A pin.
+ *
+ * @param target Emulator instance.
+ * @param pin Pin number 0..15.
+ * @return 0 or 1, or -EINVAL if @p pin is out of range.
+ */
+int tib_emul_pcal64xxa_get_output(const struct emul *target, uint8_t pin);
+
+/**
+ * @brief Get the number of rising edges seen on a PCAL6416A output pin.
+ *
+ * Each MEMS switch command is a single pulse, so this counts switch
+ * actuations per coil.
+ *
+ * @param target Emulator instance.
+ * @param pin Pin number 0..15.
+ * @return Rising edges since boot, or 0 if @p pin is out of range.
+ */
+uint32_t tib_emul_pcal64xxa_pulses(const struct emul *target, uint8_t pin);
+
+/**
+ * @brief Get the 12-bit code latched on a DAC7578 channel.
+ *
+ * @param target Emulator instance.
+ * @param channel DAC channel 0..7.
+ * @param code Out parameter for the code driving the output.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if @p channel is out of range.
+ */
+int tib_emul_dac7578_get_code(const struct emul *target, uint8_t channel, uint16_t *code);
+
+/** @} */
+
+#endif /* APP_DRIVERS_TIB_EMUL_H_ */
@@ -18,11 +18,65 @@
  */
 typedef void (*mqtt_message_cb_t)(const struct mqtt_publish_param *pub);
 
+/**
+ * @brief Zero-copy publish handler type
+ *
+ * Called for every received PUBLISH before its payload has been read.
+ * @p pub->message.payload.len holds the payload length; the handler reads
+ * it straight into its own buffer with coo_mqtt_read_payload(). Anything
+ * left unread is discarded after the handler returns. Topic and
+ * properties point into the client RX buffer and are only valid during
+ * the call.
+ *
+ * @param client MQTT client the message arrived on
+ * @param pub Publish parameters (payload not yet read)
+ */
+typedef void (*coo_mqtt_publish_handler_t)(struct mqtt_client *client,
+					   const struct mqtt_publish_param *pub);
+
+/**
+ * @brief Liveness hook type
+ *
+ * Called from the MQTT thread between blocking steps, see
+ * coo_mqtt_set_idle_hook().
+ */
+typedef void (*coo_mqtt_idle_hook_t)(void);
+
+/**
+ * @brief Pre-encoded QoS 0 publish stream for one fixed topic
+ *
+ * Set up with coo_mqtt_channel_init(); treat the fields as private.
+ */
+struct coo_mqtt_channel {
+	const char *topic;
+	int alias;                /* index into the topic alias table, -1 if none */
+	uint8_t vh_len;           /* topic name + Topic Alias property */
+	uint8_t vh[2 + CONFIG_COO_MQTT_TOPIC_SIZE + 4];
+	uint8_t alias_vh[6];      /* empty topic name + Topic Alias property */
+};
+
+/**
+ * @brief Publish counters
+ */
+struct coo_mqtt_stats {
+	uint32_t published;      /**< PUBLISH packets sent (first transmission) */
+	uint32_t acked;          /**< QoS 1/2 exchanges completed */
+	uint32_t retransmitted;  /**< packets resent with DUP after a reconnect */
+	uint32_t window_full;    /**< publishes refused with -EAGAIN */
+	uint16_t inflight;       /**< QoS 1/2 publishes currently unacknowledged */
+	uint32_t tx_packets;     /**< packets written while corked (TX coalescing) */
+	uint32_t tx_sends;       /**< socket sends used to flush them */
+	uint32_t connects;       /**< successful coo_mqtt_connect() calls */
+	uint32_t connect_time_ms; /**< duration of the last coo_mqtt_connect() */
+};
+
 /**
  * @brief Initialize the MQTT client
  *
- * Resolves the broker hostname, configures the MQTT client structure,
- * and prepares buffers for communication.
+ * Starts resolving the broker hostname in the background, configures the
+ * MQTT client structure, and prepares buffers for communication. Does not
+ * wait for DNS: coo_mqtt_connect() uses a cached or static address until
+ * the hostname resolves.
  *
  * @param client Pointer to MQTT client structure to initialize
  * @param client_id Client identifier string (will be copied)
@@ -33,13 +87,34 @@ int coo_mqtt_init(struct mqtt_client *client, const char *client_id);
 /**
  * @brief Connect to the MQTT broker
  *
- * Blocks until connection is established or fails. Automatically retries
- * on failure with exponential backoff.
+ * Blocks until connection is established. Automatically retries on failure
+ * with jittered exponential backoff (CONFIG_COO_MQTT_BACKOFF_MIN_MS up to
+ * CONFIG_COO_MQTT_BACKOFF_MAX_MS), cycling through the known broker
+ * addresses and retrying at once when the network comes back up.
+ * Once connected, QoS 1/2 messages still awaiting acknowledgement are sent
+ * again with the DUP flag.
+ *
+ * With CONFIG_COO_MQTT_SESSION_EXPIRY_S > 0 the broker keeps the session
+ * (subscriptions and QoS 1/2 messages queued for the client) across the
+ * disconnect; see coo_mqtt_session_present().
  *
  * @param client Pointer to initialized MQTT client
  */
 void coo_mqtt_connect(struct mqtt_client *client);
 
+/**
+ * @brief Set a hook called whenever the MQTT thread is between blocking steps
+ *
+ * Runs at the start of every coo_mqtt_process() call and before and after
+ * every wait in coo_mqtt_connect(), so the gap between calls is bounded by
+ * CONFIG_COO_MQTT_POLL_INTERVAL_MS while connected and by the longest
+ * backoff, TCP connect or CONNACK wait while reconnecting. Meant for
+ * watchdog check-ins. Must not block.
+ *
+ * @param hook Hook function, or NULL to remove it
+ */
+void coo_mqtt_set_idle_hook(coo_mqtt_idle_hook_t hook);
+
 /**
  * @brief Add a subscription topic
  *
@@ -56,13 +131,34 @@ int coo_mqtt_add_subscription(const char *topic_str, uint8_t qos);
  * @brief Subscribe to all registered topics
  *
  * Should be called after connection is established. Subscribes to all
- * topics previously registered with coo_mqtt_add_subscription().
+ * topics previously registered with coo_mqtt_add_subscription(). Does
+ * nothing when the broker resumed a session that already holds them.
  *
  * @param client Pointer to connected MQTT client
  * @return 0 on success, negative error code on failure
  */
 int coo_mqtt_subscribe(struct mqtt_client *client);
 
+/**
+ * @brief Check whether the broker resumed the previous session
+ *
+ * @return true if the last CONNACK had the session present flag set
+ */
+bool coo_mqtt_session_present(void);
+
+/**
+ * @brief Send a topic through an MQTT 5 topic alias
+ *
+ * The first publish on the topic after each connect carries the full name
+ * and assigns the alias; later ones send only the two-byte alias. Aliases
+ * are only used when the broker's CONNACK allows enough of them. Meant
+ * for high-rate topics. Call before coo_mqtt_connect().
+ *
+ * @param topic_str Topic string, must stay valid (not copied)
+ * @return 0 on success, -ENOMEM if CONFIG_COO_MQTT_TOPIC_ALIAS_MAX are in use
+ */
+int coo_mqtt_add_topic_alias(const char *topic_str);
+
 /**
  * @brief Set the message received callback
  *
@@ -73,17 +169,137 @@ int coo_mqtt_subscribe(struct mqtt_client *client);
  */
 void coo_mqtt_set_message_callback(mqtt_message_cb_t cb);
 
+/**
+ * @brief Set a zero-copy handler for received messages
+ *
+ * Takes precedence over coo_mqtt_set_message_callback(). Use when the
+ * payload should land directly in application storage instead of being
+ * copied out of an intermediate buffer.
+ *
+ * @param handler Handler function pointer
+ */
+void coo_mqtt_set_publish_handler(coo_mqtt_publish_handler_t handler);
+
+/**
+ * @brief Read payload of the message being handled
+ *
+ * Only valid inside a coo_mqtt_publish_handler_t. May be called several
+ * times to read the payload in pieces.
+ *
+ * @param client MQTT client passed to the handler
+ * @param buf Destination buffer
+ * @param len Number of bytes to read
+ * @return 0 on success, -EMSGSIZE if @p len exceeds the unread payload,
+ *         or a transport error
+ */
+int coo_mqtt_read_payload(struct mqtt_client *client, void *buf, size_t len);
+
 /**
  * @brief Process MQTT events
  *
  * Must be called regularly in the main loop. Polls the MQTT socket,
- * handles incoming messages, and sends keep-alive packets.
+ * handles incoming messages, and sends keep-alive packets. Returns after
+ * at most CONFIG_COO_MQTT_POLL_INTERVAL_MS when nothing arrives, or as
+ * soon as coo_mqtt_wake() is called.
  *
  * @param client Pointer to connected MQTT client
  * @return 0 on success, negative error code on failure (e.g., disconnection)
  */
 int coo_mqtt_process(struct mqtt_client *client);
 
+/**
+ * @brief Publish a message through the in-flight window
+ *
+ * QoS 0 messages are sent directly. QoS 1 and 2 messages are copied into
+ * one of CONFIG_COO_MQTT_INFLIGHT_MAX slots, given a message ID, and kept
+ * until PUBACK (QoS 1) or PUBCOMP (QoS 2) arrives. Unacknowledged messages
+ * are sent again with the DUP flag by coo_mqtt_connect(). Of the MQTT 5
+ * properties only correlation data is kept. @p param->message_id is
+ * ignored for QoS 1/2.
+ *
+ * Call from the thread that runs coo_mqtt_process().
+ *
+ * @param client Pointer to connected MQTT client
+ * @param param Message to publish
+ * @return 0 on success, -EAGAIN if the window is full (retry after
+ *         coo_mqtt_process()), -EMSGSIZE if the message does not fit a slot,
+ *         or a transport error. On a transport error a QoS 1/2 message stays
+ *         queued for retransmission.
+ */
+int coo_mqtt_publish(struct mqtt_client *client, const struct mqtt_publish_param *param);
+
+/**
+ * @brief Register a fixed-topic publish channel
+ *
+ * Registers a topic alias for @p topic_str (see coo_mqtt_add_topic_alias())
+ * and encodes the PUBLISH variable header once, both with the topic name
+ * and in its aliased form. Call before coo_mqtt_connect().
+ *
+ * @param ch Channel to initialize, must stay valid
+ * @param topic_str Topic string, must stay valid (not copied)
+ * @return 0 on success, -EMSGSIZE if the topic exceeds
+ *         CONFIG_COO_MQTT_TOPIC_SIZE. Running out of aliases is not an
+ *         error; the channel then always sends the topic name.
+ */
+int coo_mqtt_channel_init(struct coo_mqtt_channel *ch, const char *topic_str);
+
+/**
+ * @brief Publish a QoS 0 message on a channel
+ *
+ * Writes the cached header, with only the fixed-header length filled in,
+ * and the payload straight to the transport, bypassing the MQTT encoder.
+ * Over TLS it falls back to a regular aliased publish. Honors
+ * coo_mqtt_tx_cork().
+ *
+ * Call from the thread that runs coo_mqtt_process().
+ *
+ * @return 0 on success, -ENOTCONN if not connected, -EMSGSIZE if the
+ *         payload exceeds CONFIG_COO_MQTT_PAYLOAD_SIZE, or a transport error.
+ *         A transport error aborts the connection, as a partial packet
+ *         may have been sent.
+ */
+int coo_mqtt_channel_publish(struct mqtt_client *client, struct coo_mqtt_channel *ch,
+			     const void *payload, size_t len);
+
+/**
+ * @brief Start collecting outgoing packets for a single send
+ *
+ * With CONFIG_COO_MQTT_TX_COALESCE, packets written after this call are
+ * serialized back to back into one buffer instead of being sent one by
+ * one. The buffer is sent early if it fills. Without the option this is
+ * a no-op.
+ */
+void coo_mqtt_tx_cork(void);
+
+/**
+ * @brief Send the packets collected since coo_mqtt_tx_cork()
+ *
+ * @param client Pointer to connected MQTT client
+ * @return 0 on success, negative error code if the send failed
+ */
+int coo_mqtt_tx_flush(struct mqtt_client *client);
+
+/**
+ * @brief Number of free in-flight slots for QoS 1/2 publishes
+ */
+int coo_mqtt_inflight_free(void);
+
+/**
+ * @brief Read the publish counters
+ *
+ * @param out Filled with a snapshot of the counters
+ */
+void coo_mqtt_get_stats(struct coo_mqtt_stats *out);
+
+/**
+ * @brief Wake a thread blocked in coo_mqtt_process()
+ *
+ * Call after queueing a message for the MQTT thread to publish, so it does
+ * not wait for inbound data or the poll timeout. Safe from any thread; a
+ * no-op before coo_mqtt_init() or without CONFIG_COO_MQTT_WAKEUP.
+ */
+void coo_mqtt_wake(void);
+
 /**
  * @brief Main MQTT event loop
  *
@@ -7,6 +7,7 @@
 #define APP_LIB_NETWORK_H_
 
 #include <zephyr/net/socket.h>
+#include <zephyr/sys/slist.h>
 
 /**
  * @file network.h
@@ -30,6 +31,28 @@
  */
 typedef void (*coo_network_event_cb_t)(bool connected);
 
+/**
+ * @brief Additional subscriber to network state changes
+ *
+ * Lets library modules (e.g. the MQTT client) react to L4 up/down next to
+ * the application's coo_network_init() callback. Callbacks run in the
+ * network management thread and must not block.
+ */
+struct coo_network_listener {
+	sys_snode_t node;
+	coo_network_event_cb_t cb;
+};
+
+/**
+ * @brief Register a listener for network state changes
+ *
+ * May be called before or after coo_network_init(). The listener must stay
+ * valid for the lifetime of the program.
+ *
+ * @param listener Listener with @c cb set
+ */
+void coo_network_add_listener(struct coo_network_listener *listener);
+
 /**
  * @brief Initialize network subsystem
  *
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Broker address candidates for the MQTT client: the last address that
+ * accepted a connection (persisted in settings), the latest DNS result
+ * (refreshed on a background work queue so connects never wait on DNS),
+ * and a static fallback list from Kconfig.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/settings/settings.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mqtt_broker.h"
+
+LOG_MODULE_DECLARE(coo_mqtt, CONFIG_COO_MQTT_LOG_LEVEL);
+
+#define MAX_CANDIDATES (2 + CONFIG_COO_MQTT_BROKER_FALLBACK_MAX)
+
+static K_MUTEX_DEFINE(broker_lock);
+
+static struct sockaddr_in preferred;   /* last address that connected */
+static bool have_preferred;
+static struct sockaddr_in resolved;    /* latest DNS answer */
+static bool have_resolved;
+static struct sockaddr_in fallback[CONFIG_COO_MQTT_BROKER_FALLBACK_MAX];
+static int num_fallback;
+static unsigned int next_index;
+
+static K_THREAD_STACK_DEFINE(resolver_stack, CONFIG_COO_MQTT_BROKER_RESOLVER_STACK_SIZE);
+static struct k_work_q resolver_q;
+static struct k_work_delayable resolve_work;
+static bool resolver_started;
+
+static uint16_t broker_port(void)
+{
+	return htons((uint16_t)atoi(CONFIG_COO_MQTT_BROKER_PORT));
+}
+
+#if defined(CONFIG_COO_MQTT_BROKER_CACHE)
+static int broker_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+			       void *cb_arg)
+{
+	struct sockaddr_in addr;
+
+	if (!settings_name_steq(name, "broker", NULL) || len != sizeof(addr)) {
+		return 0;
+	}
+	if (read_cb(cb_arg, &addr, sizeof(addr)) == sizeof(addr) && addr.sin_family == AF_INET) {
+		k_mutex_lock(&broker_lock, K_FOREVER);
+		preferred = addr;
+		have_preferred = true;
+		k_mutex_unlock(&broker_lock);
+	}
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(coo_mqtt, "coo_mqtt", NULL, broker_settings_set, NULL, NULL);
+#endif
+
+static bool addr_equal(const struct sockaddr_in *a, const struct sockaddr_in *b)
+{
+	return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+static void resolve_handler(struct k_work *work)
+{
+	struct addrinfo *result;
+	const struct addrinfo hints = {
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_STREAM
+	};
+	int rc;
+
+	ARG_UNUSED(work);
+
+	rc = getaddrinfo(CONFIG_COO_MQTT_BROKER_HOSTNAME, CONFIG_COO_MQTT_BROKER_PORT,
+			 &hints, &result);
+	if (rc != 0 || result == NULL) {
+		LOG_WRN("Failed to resolve broker hostname [%s]", gai_strerror(rc));
+		/* Retry sooner than the refresh interval while unresolved */
+		k_work_reschedule_for_queue(&resolver_q, &resolve_work,
+					    K_SECONDS(CONFIG_COO_MQTT_BROKER_RESOLVE_RETRY_S));
+		return;
+	}
+
+	k_mutex_lock(&broker_lock, K_FOREVER);
+	resolved = *(struct sockaddr_in *)result->ai_addr;
+	have_resolved = true;
+	k_mutex_unlock(&broker_lock);
+	freeaddrinfo(result);
+
+	LOG_DBG("Broker resolved");
+
+	if (CONFIG_COO_MQTT_BROKER_RESOLVE_INTERVAL_S > 0) {
+		k_work_reschedule_for_queue(&resolver_q, &resolve_work,
+					    K_SECONDS(CONFIG_COO_MQTT_BROKER_RESOLVE_INTERVAL_S));
+	}
+}
+
+static void parse_fallbacks(void)
+{
+	char list[] = CONFIG_COO_MQTT_BROKER_FALLBACK_ADDRS;
+	char *saveptr;
+
+	for (char *tok = strtok_r(list, ", ", &saveptr);
+	     tok != NULL && num_fallback < ARRAY_SIZE(fallback);
+	     tok = strtok_r(NULL, ", ", &saveptr)) {
+		struct sockaddr_in *addr = &fallback[num_fallback];
+
+		if (zsock_inet_pton(AF_INET, tok, &addr->sin_addr) != 1) {
+			LOG_WRN("Ignoring invalid broker fallback '%s'", tok);
+			continue;
+		}
+		addr->sin_family = AF_INET;
+		addr->sin_port = broker_port();
+		num_fallback++;
+	}
+}
+
+void coo_mqtt_broker_init(void)
+{
+	struct sockaddr_in literal = {
+		.sin_family = AF_INET,
+	};
+
+	parse_fallbacks();
+
+	/* A numeric "hostname" needs no resolver */
+	if (zsock_inet_pton(AF_INET, CONFIG_COO_MQTT_BROKER_HOSTNAME, &literal.sin_addr) == 1) {
+		literal.sin_port = broker_port();
+		k_mutex_lock(&broker_lock, K_FOREVER);
+		resolved = literal;
+		have_resolved = true;
+		k_mutex_unlock(&broker_lock);
+		return;
+	}
+
+	if (!resolver_started) {
+		k_work_queue_start(&resolver_q, resolver_stack,
+				   K_THREAD_STACK_SIZEOF(resolver_stack),
+				   CONFIG_COO_MQTT_BROKER_RESOLVER_PRIORITY, NULL);
+		k_thread_name_set(&resolver_q.thread, "mqtt_resolver");
+		k_work_init_delayable(&resolve_work, resolve_handler);
+		resolver_started = true;
+	}
+	coo_mqtt_broker_resolve_now();
+}
+
+void coo_mqtt_broker_resolve_now(void)
+{
+	if (resolver_started) {
+		k_work_reschedule_for_queue(&resolver_q, &resolve_work, K_NO_WAIT);
+	}
+}
+
+int coo_mqtt_broker_next(struct sockaddr_storage *addr)
+{
+	struct sockaddr_in list[MAX_CANDIDATES];
+	int n = 0;
+
+	k_mutex_lock(&broker_lock, K_FOREVER);
+
+	if (have_preferred) {
+		list[n++] = preferred;
+	}
+	if (have_resolved && !(n > 0 && addr_equal(&list[0], &resolved))) {
+		list[n++] = resolved;
+	}
+	for (int i = 0; i < num_fallback; i++) {
+		bool dup = false;
+
+		for (int j = 0; j < n; j++) {
+			dup |= addr_equal(&list[j], &fallback[i]);
+		}
+		if (!dup) {
+			list[n++] = fallback[i];
+		}
+	}
+
+	if (n > 0) {
+		memset(addr, 0, sizeof(*addr));
+		memcpy(addr, &list[next_index % n], sizeof(list[0]));
+	}
+
+	k_mutex_unlock(&broker_lock);
+
+	return n > 0 ? 0 : -ENOENT;
+}
+
+void coo_mqtt_broker_report(const struct sockaddr_storage *addr, bool connected)
+{
+	const struct sockaddr_in *addr4 = (const struct sockaddr_in *)addr;
+	bool changed;
+
+	if (!connected) {
+		/* Rotate to the next candidate, and check whether DNS moved */
+		next_index++;
+		coo_mqtt_broker_resolve_now();
+		return;
+	}
+
+	k_mutex_lock(&broker_lock, K_FOREVER);
+	changed = !have_preferred || !addr_equal(&preferred, addr4);
+	preferred = *addr4;
+	have_preferred = true;
+	next_index = 0;
+	k_mutex_unlock(&broker_lock);
+
+#if defined(CONFIG_COO_MQTT_BROKER_CACHE)
+	if (changed) {
+		int rc = settings_save_one("coo_mqtt/broker", addr4, sizeof(*addr4));
+
+		if (rc != 0) {
+			LOG_WRN("Failed to cache broker address (%d)", rc);
+		}
+	}
+#else
+	ARG_UNUSED(changed);
+#endif
+}
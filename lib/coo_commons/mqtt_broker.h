@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Internal interface: broker address selection for mqtt_client.c
+ */
+
+#ifndef COO_COMMONS_MQTT_BROKER_H
+#define COO_COMMONS_MQTT_BROKER_H
+
+#include <zephyr/net/socket.h>
+#include <stdbool.h>
+
+/** Load static fallbacks and start background resolution */
+void coo_mqtt_broker_init(void);
+
+/**
+ * Pick the address for the next connection attempt: the last address that
+ * worked first, then the latest DNS result, then the static fallbacks.
+ *
+ * @return 0 on success, -ENOENT if no address is known yet
+ */
+int coo_mqtt_broker_next(struct sockaddr_storage *addr);
+
+/** Report the outcome of an attempt on the address from coo_mqtt_broker_next() */
+void coo_mqtt_broker_report(const struct sockaddr_storage *addr, bool connected);
+
+/** Re-resolve the broker hostname in the background as soon as possible */
+void coo_mqtt_broker_resolve_now(void);
+
+#endif /* COO_COMMONS_MQTT_BROKER_H */
@@ -4,46 +4,161 @@
  */
 
 #include <coo_commons/mqtt_client.h>
+#include <coo_commons/network.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/net/socket.h>
+#include <zephyr/random/random.h>
+#include <zephyr/sys/byteorder.h>
+#include <errno.h>
 #include <string.h>
 
-LOG_MODULE_REGISTER(coo_mqtt, LOG_LEVEL_DBG);
+#if defined(CONFIG_COO_MQTT_WAKEUP)
+#include <zephyr/zvfs/eventfd.h>
+#endif
 
-/* Buffers for MQTT client */
-static uint8_t rx_buffer[CONFIG_COO_MQTT_PAYLOAD_SIZE];
-static uint8_t tx_buffer[CONFIG_COO_MQTT_PAYLOAD_SIZE];
+#include "mqtt_broker.h"
+#include "mqtt_transport.h"
+
+LOG_MODULE_REGISTER(coo_mqtt, CONFIG_COO_MQTT_LOG_LEVEL);
+
+/* Buffers for MQTT client. TX holds only packet headers: publish payloads
+ * are sent straight from the caller's buffer.
+ */
+static uint8_t rx_buffer[CONFIG_COO_MQTT_RX_BUFFER_SIZE];
+static uint8_t tx_buffer[CONFIG_COO_MQTT_TX_BUFFER_SIZE];
+
+/* Received publish payload, handed to the user callback */
+static uint8_t rx_payload[CONFIG_COO_MQTT_PAYLOAD_SIZE + 1];
 
 /* MQTT broker details */
 static struct sockaddr_storage broker;
 
-/* Socket descriptor */
-static struct zsock_pollfd fds[1];
+/* Socket descriptor, plus the wake-up eventfd while processing */
+static struct zsock_pollfd fds[2];
 static int nfds;
 
+#if defined(CONFIG_COO_MQTT_WAKEUP)
+static int wake_fd = -1;
+#endif
+
 /* MQTT connectivity status flag */
 static bool mqtt_connected;
 
+/* Broker kept our session (and subscriptions) from the last connection */
+static bool session_present;
+
 /* MQTT client ID buffer */
 static uint8_t client_id[50];
 
 /* User callback for messages */
 static mqtt_message_cb_t user_mqtt_cb = NULL;
+static coo_mqtt_publish_handler_t user_publish_handler = NULL;
+static coo_mqtt_idle_hook_t user_idle_hook = NULL;
+
+/* Payload bytes of the current PUBLISH not yet read by the handler */
+static size_t payload_remaining;
 
 /* Subscriptions */
 #define MAX_SUBSCRIPTIONS 4
 static struct mqtt_topic subscriptions[MAX_SUBSCRIPTIONS];
 static int num_subscriptions = 0;
 
-/* Retry configuration */
-#define MSECS_WAIT_RECONNECT   5000
-#define MSECS_NET_POLL_TIMEOUT 30000
+/* Outgoing topic aliases; alias N is topic_aliases[N - 1] */
+struct topic_alias {
+	const char *topic;
+	size_t len;
+	bool assigned;      /* full name sent on this connection */
+};
+
+static struct topic_alias topic_aliases[MAX(CONFIG_COO_MQTT_TOPIC_ALIAS_MAX, 1)];
+static int num_topic_aliases;
+static uint16_t broker_alias_max;
+
+/* QoS 1/2 publishes awaiting PUBACK / PUBCOMP, with their own copy of
+ * the message so they can be sent again after a reconnect
+ */
+enum inflight_state {
+	INFLIGHT_FREE,
+	INFLIGHT_PUBLISH,   /* waiting for PUBACK (QoS 1) or PUBREC (QoS 2) */
+	INFLIGHT_PUBREL,    /* QoS 2: PUBREL sent, waiting for PUBCOMP */
+};
+
+struct inflight {
+	enum inflight_state state;
+	uint32_t seq;       /* send order, kept on retransmission */
+	uint16_t message_id;
+	uint8_t qos;
+	uint16_t topic_len;
+	uint16_t payload_len;
+	uint16_t corr_len;
+	uint8_t topic[CONFIG_COO_MQTT_TOPIC_SIZE];
+	uint8_t payload[CONFIG_COO_MQTT_PAYLOAD_SIZE];
+	uint8_t corr[CONFIG_COO_MQTT_CORRELATION_DATA_SIZE];
+};
+
+static struct inflight inflight[CONFIG_COO_MQTT_INFLIGHT_MAX];
+static uint32_t inflight_seq;
+static uint16_t next_message_id;
+static struct coo_mqtt_stats stats;
+
+/* Reconnect backoff, cut short when the network comes back up */
+static K_SEM_DEFINE(reconnect_sem, 0, 1);
+static struct coo_network_listener net_listener;
+static atomic_t backoff_reset;
 
 void coo_mqtt_set_message_callback(mqtt_message_cb_t cb)
 {
 	user_mqtt_cb = cb;
 }
 
+void coo_mqtt_set_publish_handler(coo_mqtt_publish_handler_t handler)
+{
+	user_publish_handler = handler;
+}
+
+void coo_mqtt_set_idle_hook(coo_mqtt_idle_hook_t hook)
+{
+	user_idle_hook = hook;
+}
+
+static inline void idle_hook(void)
+{
+	if (user_idle_hook) {
+		user_idle_hook();
+	}
+}
+
+int coo_mqtt_read_payload(struct mqtt_client *client, void *buf, size_t len)
+{
+	int rc;
+
+	if (len > payload_remaining) {
+		return -EMSGSIZE;
+	}
+
+	rc = mqtt_readall_publish_payload(client, buf, len);
+	if (rc == 0) {
+		payload_remaining -= len;
+	}
+	return rc;
+}
+
+/** Read and drop whatever payload the handler left unread */
+static int discard_payload(struct mqtt_client *client)
+{
+	uint8_t scratch[32];
+
+	while (payload_remaining > 0) {
+		size_t n = MIN(payload_remaining, sizeof(scratch));
+		int rc = coo_mqtt_read_payload(client, scratch, n);
+
+		if (rc != 0) {
+			return rc;
+		}
+	}
+	return 0;
+}
+
 int coo_mqtt_add_subscription(const char *topic_str, uint8_t qos)
 {
 	if (num_subscriptions >= MAX_SUBSCRIPTIONS) {
@@ -56,19 +171,258 @@ int coo_mqtt_add_subscription(const char *topic_str, uint8_t qos)
 	return 0;
 }
 
+int coo_mqtt_add_topic_alias(const char *topic_str)
+{
+	if (num_topic_aliases >= CONFIG_COO_MQTT_TOPIC_ALIAS_MAX) {
+		return -ENOMEM;
+	}
+	topic_aliases[num_topic_aliases].topic = topic_str;
+	topic_aliases[num_topic_aliases].len = strlen(topic_str);
+	num_topic_aliases++;
+	return 0;
+}
+
+/**
+ * Replace the topic with its alias if it has one. Returns the alias entry
+ * to mark assigned once the publish has gone out, or NULL.
+ */
+static struct topic_alias *topic_alias_apply(struct mqtt_publish_param *param)
+{
+#if defined(CONFIG_MQTT_VERSION_5_0)
+	for (int i = 0; i < num_topic_aliases && i < broker_alias_max; i++) {
+		struct topic_alias *alias = &topic_aliases[i];
+
+		if (alias->len != param->message.topic.topic.size ||
+		    memcmp(alias->topic, param->message.topic.topic.utf8, alias->len) != 0) {
+			continue;
+		}
+		param->prop.topic_alias = i + 1;
+		if (alias->assigned) {
+			/* Broker already maps the alias; an empty name selects it */
+			param->message.topic.topic.size = 0;
+			return NULL;
+		}
+		return alias;
+	}
+#else
+	ARG_UNUSED(param);
+#endif
+	return NULL;
+}
+
+static int publish_aliased(struct mqtt_client *client, struct mqtt_publish_param *param)
+{
+	struct topic_alias *alias = topic_alias_apply(param);
+	int rc = mqtt_publish(client, param);
+
+	if (rc == 0 && alias != NULL) {
+		alias->assigned = true;
+	}
+	return rc;
+}
+
+/* PUBLISH fixed header byte for QoS 0, no DUP, no retain */
+#define PUBLISH_QOS0_HEADER 0x30
+#define PROP_TOPIC_ALIAS    0x23
+
+/* Topic length, topic, then a 4 byte property block, counted in vh_len */
+BUILD_ASSERT(2 + CONFIG_COO_MQTT_TOPIC_SIZE + 4 <= UINT8_MAX,
+	     "CONFIG_COO_MQTT_TOPIC_SIZE too large for coo_mqtt_channel.vh_len");
+
+int coo_mqtt_channel_init(struct coo_mqtt_channel *ch, const char *topic_str)
+{
+	size_t len = strlen(topic_str);
+
+	if (len > CONFIG_COO_MQTT_TOPIC_SIZE) {
+		return -EMSGSIZE;
+	}
+
+	ch->topic = topic_str;
+	ch->alias = -1;
+	for (int i = 0; i < num_topic_aliases; i++) {
+		if (strcmp(topic_aliases[i].topic, topic_str) == 0) {
+			ch->alias = i;
+		}
+	}
+	if (ch->alias < 0 && coo_mqtt_add_topic_alias(topic_str) == 0) {
+		ch->alias = num_topic_aliases - 1;
+	}
+
+	/* Topic name, then a property block holding only the Topic Alias */
+	sys_put_be16(len, &ch->vh[0]);
+	memcpy(&ch->vh[2], topic_str, len);
+	ch->vh[2 + len] = 3;
+	ch->vh[3 + len] = PROP_TOPIC_ALIAS;
+	sys_put_be16(ch->alias + 1, &ch->vh[4 + len]);
+	ch->vh_len = len + 6;
+
+	sys_put_be16(0, &ch->alias_vh[0]);
+	memcpy(&ch->alias_vh[2], &ch->vh[2 + len], 4);
+
+	return 0;
+}
+
+static int transport_write_msg(struct mqtt_client *client, struct msghdr *msg)
+{
+#if defined(CONFIG_COO_MQTT_TX_COALESCE)
+	return coo_mqtt_transport_write_msg(client, msg);
+#else
+	while (msg->msg_iovlen > 0) {
+		ssize_t sent = zsock_sendmsg(client->transport.tcp.sock, msg, 0);
+
+		if (sent < 0) {
+			return -errno;
+		}
+		/* Skip what went out and retry the rest */
+		while (msg->msg_iovlen > 0 && sent >= msg->msg_iov->iov_len) {
+			sent -= msg->msg_iov->iov_len;
+			msg->msg_iov++;
+			msg->msg_iovlen--;
+		}
+		if (msg->msg_iovlen > 0) {
+			msg->msg_iov->iov_base = (uint8_t *)msg->msg_iov->iov_base + sent;
+			msg->msg_iov->iov_len -= sent;
+		}
+	}
+	return 0;
+#endif
+}
+
+int coo_mqtt_channel_publish(struct mqtt_client *client, struct coo_mqtt_channel *ch,
+			     const void *payload, size_t len)
+{
+	static const uint8_t no_props;
+	struct topic_alias *assign = NULL;
+	uint8_t fixed[5];
+	struct iovec iov[4];
+	struct msghdr msg = {
+		.msg_iov = iov,
+	};
+	size_t remaining;
+	size_t hdr_len = 1;
+	int rc;
+
+	if (!mqtt_connected) {
+		return -ENOTCONN;
+	}
+	if (len > CONFIG_COO_MQTT_PAYLOAD_SIZE) {
+		return -EMSGSIZE;
+	}
+
+	if (!IS_ENABLED(CONFIG_MQTT_VERSION_5_0) ||
+	    (client->transport.type != MQTT_TRANSPORT_NON_SECURE &&
+	     client->transport.type != MQTT_TRANSPORT_CUSTOM)) {
+		struct mqtt_publish_param param = {
+			.message.topic.qos = MQTT_QOS_0_AT_MOST_ONCE,
+			.message.topic.topic.utf8 = (const uint8_t *)ch->topic,
+			.message.topic.topic.size = strlen(ch->topic),
+			.message.payload.data = (uint8_t *)payload,
+			.message.payload.len = len,
+		};
+
+		rc = publish_aliased(client, &param);
+		if (rc == 0) {
+			stats.published++;
+		}
+		return rc;
+	}
+
+	msg.msg_iovlen = 1;
+	if (ch->alias >= 0 && ch->alias < broker_alias_max) {
+		if (topic_aliases[ch->alias].assigned) {
+			iov[1] = (struct iovec){ ch->alias_vh, sizeof(ch->alias_vh) };
+		} else {
+			assign = &topic_aliases[ch->alias];
+			iov[1] = (struct iovec){ ch->vh, ch->vh_len };
+		}
+		msg.msg_iovlen = 2;
+	} else {
+		/* Topic name only, with an empty property block */
+		iov[1] = (struct iovec){ ch->vh, ch->vh_len - 4 };
+		iov[2] = (struct iovec){ (void *)&no_props, 1 };
+		msg.msg_iovlen = 3;
+	}
+	iov[msg.msg_iovlen++] = (struct iovec){ (void *)payload, len };
+
+	/* Only the Remaining Length changes from one publish to the next */
+	remaining = 0;
+	for (size_t i = 1; i < msg.msg_iovlen; i++) {
+		remaining += iov[i].iov_len;
+	}
+	fixed[0] = PUBLISH_QOS0_HEADER;
+	do {
+		fixed[hdr_len] = remaining & 0x7f;
+		remaining >>= 7;
+		if (remaining > 0) {
+			fixed[hdr_len] |= 0x80;
+		}
+		hdr_len++;
+	} while (remaining > 0);
+	iov[0] = (struct iovec){ fixed, hdr_len };
+
+	/* Serialized with the MQTT library's own writes, as mqtt_publish() is */
+	sys_mutex_lock(&client->internal.mutex, K_FOREVER);
+	rc = transport_write_msg(client, &msg);
+	if (rc == 0) {
+		client->internal.last_activity = k_uptime_get_32();
+	}
+	sys_mutex_unlock(&client->internal.mutex);
+	if (rc != 0) {
+		/* Part of the PUBLISH may already be on the socket, so the
+		 * stream cannot carry another packet; drop the connection and
+		 * let the reconnect logic start clean, as the library does
+		 */
+		LOG_ERR("Channel publish failed [%d], aborting connection", rc);
+		mqtt_abort(client);
+		return rc;
+	}
+	if (assign != NULL) {
+		assign->assigned = true;
+	}
+	stats.published++;
+	return 0;
+}
+
 bool coo_mqtt_is_connected(void)
 {
 	return mqtt_connected;
 }
 
-static void prepare_fds(struct mqtt_client *client)
+bool coo_mqtt_session_present(void)
+{
+	return session_present;
+}
+
+static void prepare_fds(struct mqtt_client *client, bool with_wake)
 {
-	if (client->transport.type == MQTT_TRANSPORT_NON_SECURE) {
+	if (client->transport.type == MQTT_TRANSPORT_NON_SECURE ||
+	    client->transport.type == MQTT_TRANSPORT_CUSTOM) {
 		fds[0].fd = client->transport.tcp.sock;
 	}
 
 	fds[0].events = ZSOCK_POLLIN;
+	fds[0].revents = 0;
 	nfds = 1;
+
+#if defined(CONFIG_COO_MQTT_WAKEUP)
+	if (with_wake && wake_fd >= 0) {
+		fds[1].fd = wake_fd;
+		fds[1].events = ZSOCK_POLLIN;
+		fds[1].revents = 0;
+		nfds = 2;
+	}
+#else
+	ARG_UNUSED(with_wake);
+#endif
+}
+
+void coo_mqtt_wake(void)
+{
+#if defined(CONFIG_COO_MQTT_WAKEUP)
+	if (wake_fd >= 0) {
+		(void)zvfs_eventfd_write(wake_fd, 1);
+	}
+#endif
 }
 
 static void clear_fds(void)
@@ -78,10 +432,14 @@ static void clear_fds(void)
 
 static inline void on_mqtt_connect(void)
 {
+	uint8_t broker_ip[NET_IPV4_ADDR_LEN];
+
 	mqtt_connected = true;
+	inet_ntop(AF_INET, &((struct sockaddr_in *)&broker)->sin_addr, broker_ip,
+		  sizeof(broker_ip));
 	LOG_INF("Connected to MQTT broker!");
-	LOG_INF("Hostname: %s", CONFIG_COO_MQTT_BROKER_HOSTNAME);
-	LOG_INF("Client ID: %s", client_id);
+	LOG_INF("Hostname: %s (%s)", CONFIG_COO_MQTT_BROKER_HOSTNAME, broker_ip);
+	LOG_INF("Client ID: %s%s", client_id, session_present ? " (session resumed)" : "");
 	LOG_INF("Port: %s", CONFIG_COO_MQTT_BROKER_PORT);
 }
 
@@ -96,8 +454,21 @@ static inline void on_mqtt_disconnect(void)
 static void on_mqtt_publish(struct mqtt_client *const client, const struct mqtt_evt *evt)
 {
 	int rc;
-	uint8_t payload[CONFIG_COO_MQTT_PAYLOAD_SIZE + 1] = {0};
+	uint8_t *payload = rx_payload;
 
+	if (user_publish_handler) {
+		/* The handler reads the payload into its own storage */
+		payload_remaining = evt->param.publish.message.payload.len;
+		user_publish_handler(client, &evt->param.publish);
+
+		rc = discard_payload(client);
+		if (rc != 0) {
+			LOG_ERR("Failed to skip received MQTT payload [%d]", rc);
+		}
+		return;
+	}
+
+	/* Only the MQTT thread gets here, so one static buffer is enough */
 	rc = mqtt_read_publish_payload(client, payload, CONFIG_COO_MQTT_PAYLOAD_SIZE);
 	if (rc < 0) {
 		LOG_ERR("Failed to read received MQTT payload [%d]", rc);
@@ -107,8 +478,7 @@ static void on_mqtt_publish(struct mqtt_client *const client, const struct mqtt_
 	/* Place null terminator at end of payload buffer */
 	payload[rc] = '\0';
 
-	LOG_INF("MQTT payload received!");
-	LOG_INF("topic: '%s', payload: %s", evt->param.publish.message.topic.topic.utf8, payload);
+	LOG_DBG("topic: '%s', payload: %s", evt->param.publish.message.topic.topic.utf8, payload);
 
 	struct mqtt_publish_param *const publish_param = &evt->param.publish;
 	publish_param->message.payload.data = payload;
@@ -119,6 +489,182 @@ static void on_mqtt_publish(struct mqtt_client *const client, const struct mqtt_
 	}
 }
 
+static struct inflight *inflight_find(uint16_t message_id)
+{
+	for (int i = 0; i < ARRAY_SIZE(inflight); i++) {
+		if (inflight[i].state != INFLIGHT_FREE && inflight[i].message_id == message_id) {
+			return &inflight[i];
+		}
+	}
+	return NULL;
+}
+
+static void inflight_release(uint16_t message_id)
+{
+	struct inflight *slot = inflight_find(message_id);
+
+	if (slot == NULL) {
+		return;
+	}
+	slot->state = INFLIGHT_FREE;
+	stats.inflight--;
+	stats.acked++;
+}
+
+static uint16_t inflight_next_id(void)
+{
+	/* Non-zero and not already in flight */
+	do {
+		next_message_id++;
+	} while (next_message_id == 0 || inflight_find(next_message_id) != NULL);
+
+	return next_message_id;
+}
+
+static int inflight_send(struct mqtt_client *client, struct inflight *slot, bool dup)
+{
+	if (slot->state == INFLIGHT_PUBREL) {
+		const struct mqtt_pubrel_param rel_param = {
+			.message_id = slot->message_id
+		};
+
+		return mqtt_publish_qos2_release(client, &rel_param);
+	}
+
+	struct mqtt_publish_param param = {
+		.message.topic.qos = slot->qos,
+		.message.topic.topic.utf8 = slot->topic,
+		.message.topic.topic.size = slot->topic_len,
+		.message.payload.data = slot->payload,
+		.message.payload.len = slot->payload_len,
+		.message_id = slot->message_id,
+		.dup_flag = dup,
+		.retain_flag = 0,
+	};
+#if defined(CONFIG_MQTT_VERSION_5_0)
+	param.prop.correlation_data.data = slot->corr;
+	param.prop.correlation_data.len = slot->corr_len;
+#endif
+
+	return publish_aliased(client, &param);
+}
+
+/** Send every unacknowledged message again, oldest first */
+static void inflight_resend(struct mqtt_client *client)
+{
+	uint32_t last_seq = 0;
+	bool first = true;
+
+	while (true) {
+		struct inflight *next = NULL;
+
+		for (int i = 0; i < ARRAY_SIZE(inflight); i++) {
+			struct inflight *slot = &inflight[i];
+
+			if (slot->state == INFLIGHT_FREE || (!first && slot->seq <= last_seq)) {
+				continue;
+			}
+			if (next == NULL || slot->seq < next->seq) {
+				next = slot;
+			}
+		}
+		if (next == NULL) {
+			break;
+		}
+
+		if (inflight_send(client, next, true) != 0) {
+			/* Connection lost again; the next reconnect retries */
+			break;
+		}
+		stats.retransmitted++;
+		last_seq = next->seq;
+		first = false;
+	}
+}
+
+int coo_mqtt_publish(struct mqtt_client *client, const struct mqtt_publish_param *param)
+{
+	struct inflight *slot = NULL;
+	int rc;
+
+	if (param->message.topic.qos == MQTT_QOS_0_AT_MOST_ONCE) {
+		struct mqtt_publish_param aliased = *param;
+
+		rc = publish_aliased(client, &aliased);
+		if (rc == 0) {
+			stats.published++;
+		}
+		return rc;
+	}
+
+	if (param->message.topic.topic.size > CONFIG_COO_MQTT_TOPIC_SIZE ||
+	    param->message.payload.len > CONFIG_COO_MQTT_PAYLOAD_SIZE) {
+		return -EMSGSIZE;
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(inflight); i++) {
+		if (inflight[i].state == INFLIGHT_FREE) {
+			slot = &inflight[i];
+			break;
+		}
+	}
+	if (slot == NULL) {
+		stats.window_full++;
+		return -EAGAIN;
+	}
+
+	slot->message_id = inflight_next_id();
+	slot->seq = ++inflight_seq;
+	slot->qos = param->message.topic.qos;
+	slot->topic_len = param->message.topic.topic.size;
+	memcpy(slot->topic, param->message.topic.topic.utf8, slot->topic_len);
+	slot->payload_len = param->message.payload.len;
+	memcpy(slot->payload, param->message.payload.data, slot->payload_len);
+	slot->corr_len = 0;
+#if defined(CONFIG_MQTT_VERSION_5_0)
+	if (param->prop.correlation_data.len <= sizeof(slot->corr)) {
+		slot->corr_len = param->prop.correlation_data.len;
+		memcpy(slot->corr, param->prop.correlation_data.data, slot->corr_len);
+	}
+#endif
+	slot->state = INFLIGHT_PUBLISH;
+	stats.inflight++;
+
+	/* Even if the send fails the message stays in flight and goes out
+	 * again after the reconnect
+	 */
+	rc = inflight_send(client, slot, false);
+	if (rc == 0) {
+		stats.published++;
+	}
+	return rc;
+}
+
+int coo_mqtt_inflight_free(void)
+{
+	return CONFIG_COO_MQTT_INFLIGHT_MAX - stats.inflight;
+}
+
+void coo_mqtt_get_stats(struct coo_mqtt_stats *out)
+{
+	*out = stats;
+#if defined(CONFIG_COO_MQTT_TX_COALESCE)
+	coo_mqtt_transport_stats(out);
+#endif
+}
+
+#if !defined(CONFIG_COO_MQTT_TX_COALESCE)
+void coo_mqtt_tx_cork(void)
+{
+}
+
+int coo_mqtt_tx_flush(struct mqtt_client *client)
+{
+	ARG_UNUSED(client);
+	return 0;
+}
+#endif
+
 /** Handler for asynchronous MQTT events */
 static void mqtt_event_handler(struct mqtt_client *const client, const struct mqtt_evt *evt)
 {
@@ -128,6 +674,16 @@ static void mqtt_event_handler(struct mqtt_client *const client, const struct mq
 			LOG_ERR("MQTT Event Connect failed [%d]", evt->result);
 			break;
 		}
+
+		/* Aliases live only as long as the network connection */
+		for (int i = 0; i < num_topic_aliases; i++) {
+			topic_aliases[i].assigned = false;
+		}
+#if defined(CONFIG_MQTT_VERSION_5_0)
+		broker_alias_max = evt->param.connack.prop.topic_alias_maximum;
+#endif
+		session_present = evt->param.connack.session_present_flag &&
+				  CONFIG_COO_MQTT_SESSION_EXPIRY_S > 0;
 		on_mqtt_connect();
 		break;
 
@@ -140,6 +696,8 @@ static void mqtt_event_handler(struct mqtt_client *const client, const struct mq
 		break;
 
 	case MQTT_EVT_PUBACK:
+		/* A negative ack also ends the exchange; the broker won't take it */
+		inflight_release(evt->param.puback.message_id);
 		if (evt->result != 0) {
 			LOG_ERR("MQTT PUBACK error [%d]", evt->result);
 			break;
@@ -149,17 +707,26 @@ static void mqtt_event_handler(struct mqtt_client *const client, const struct mq
 
 	case MQTT_EVT_PUBREC:
 		if (evt->result != 0) {
+			inflight_release(evt->param.pubrec.message_id);
 			LOG_ERR("MQTT PUBREC error [%d]", evt->result);
 			break;
 		}
 
 		LOG_DBG("PUBREC packet ID: %u", evt->param.pubrec.message_id);
 
-		const struct mqtt_pubrel_param rel_param = {
-			.message_id = evt->param.pubrec.message_id
-		};
+		struct inflight *slot = inflight_find(evt->param.pubrec.message_id);
+
+		if (slot != NULL) {
+			/* From here on a reconnect resends the PUBREL, not the message */
+			slot->state = INFLIGHT_PUBREL;
+			inflight_send(client, slot, false);
+		} else {
+			const struct mqtt_pubrel_param rel_param = {
+				.message_id = evt->param.pubrec.message_id
+			};
 
-		mqtt_publish_qos2_release(client, &rel_param);
+			mqtt_publish_qos2_release(client, &rel_param);
+		}
 		break;
 
 	case MQTT_EVT_PUBREL:
@@ -178,6 +745,7 @@ static void mqtt_event_handler(struct mqtt_client *const client, const struct mq
 		break;
 
 	case MQTT_EVT_PUBCOMP:
+		inflight_release(evt->param.pubcomp.message_id);
 		if (evt->result != 0) {
 			LOG_ERR("MQTT PUBCOMP error %d", evt->result);
 			break;
@@ -219,11 +787,11 @@ static void mqtt_event_handler(struct mqtt_client *const client, const struct mq
 }
 
 /** Poll the MQTT socket for received data */
-static int poll_mqtt_socket(struct mqtt_client *client, int timeout)
+static int poll_mqtt_socket(struct mqtt_client *client, int timeout, bool with_wake)
 {
 	int rc;
 
-	prepare_fds(client);
+	prepare_fds(client, with_wake);
 
 	if (nfds <= 0) {
 		return -EINVAL;
@@ -241,10 +809,16 @@ int coo_mqtt_subscribe(struct mqtt_client *client)
 {
 	int rc;
 
+	if (session_present) {
+		LOG_INF("Session resumed, subscriptions kept by broker");
+		return 0;
+	}
+
 	const struct mqtt_subscription_list sub_list = {
 		.list = subscriptions,
 		.list_count = num_subscriptions,
-		.message_id = 5841u
+		/* Shares the identifier space with in-flight publishes */
+		.message_id = inflight_next_id()
 	};
 
 	LOG_INF("Subscribing to %d topic(s)", sub_list.list_count);
@@ -260,9 +834,25 @@ int coo_mqtt_subscribe(struct mqtt_client *client)
 int coo_mqtt_process(struct mqtt_client *client)
 {
 	int rc;
+	int timeout = mqtt_keepalive_time_left(client);
 
-	rc = poll_mqtt_socket(client, mqtt_keepalive_time_left(client));
+	idle_hook();
+
+	/* Keep-alive disabled reports -1 (wait forever) */
+	if (timeout < 0 || timeout > CONFIG_COO_MQTT_POLL_INTERVAL_MS) {
+		timeout = CONFIG_COO_MQTT_POLL_INTERVAL_MS;
+	}
+
+	rc = poll_mqtt_socket(client, timeout, true);
 	if (rc != 0) {
+#if defined(CONFIG_COO_MQTT_WAKEUP)
+		if (nfds > 1 && (fds[1].revents & ZSOCK_POLLIN)) {
+			zvfs_eventfd_t count;
+
+			/* Consume the wake-up; the caller drains its queues next */
+			(void)zvfs_eventfd_read(wake_fd, &count);
+		}
+#endif
 		if (fds[0].revents & ZSOCK_POLLIN) {
 			/* MQTT data received */
 			rc = mqtt_input(client);
@@ -276,10 +866,13 @@ int coo_mqtt_process(struct mqtt_client *client)
 				return -ENOTCONN;
 			}
 		}
-	} else {
-		/* Socket poll timed out, time to call mqtt_live() */
+	}
+
+	/* Wake-ups and inbound traffic can keep the poll from ever timing out */
+	if (mqtt_keepalive_time_left(client) == 0) {
+		/* Keep-alive due, time to call mqtt_live() */
 		rc = mqtt_live(client);
-		if (rc != 0) {
+		if (rc != 0 && rc != -EAGAIN) {
 			LOG_ERR("MQTT Live failed [%d]", rc);
 			return rc;
 		}
@@ -306,65 +899,107 @@ void coo_mqtt_run(struct mqtt_client *client)
 	mqtt_disconnect(client, NULL);
 }
 
+static void on_network_event(bool connected)
+{
+	if (connected) {
+		/* Retry right away instead of sitting out the backoff */
+		atomic_set(&backoff_reset, 1);
+		coo_mqtt_broker_resolve_now();
+		k_sem_give(&reconnect_sem);
+	}
+}
+
+/** Wait out the backoff: half fixed, half random */
+static void reconnect_wait(uint32_t backoff_ms)
+{
+	uint32_t delay = backoff_ms / 2 + sys_rand32_get() % (backoff_ms / 2 + 1);
+
+	(void)k_sem_take(&reconnect_sem, K_MSEC(delay));
+}
+
 void coo_mqtt_connect(struct mqtt_client *client)
 {
+	uint32_t backoff = CONFIG_COO_MQTT_BACKOFF_MIN_MS;
+	int64_t start = k_uptime_get();
+	int attempts = 0;
 	int rc = 0;
 
 	mqtt_connected = false;
+	k_sem_reset(&reconnect_sem);
+	atomic_clear(&backoff_reset);
 
 	/* Block until MQTT CONNACK event callback occurs */
 	while (!mqtt_connected) {
+		idle_hook();
+		if (attempts > 0) {
+			reconnect_wait(backoff);
+			idle_hook();
+			if (atomic_clear(&backoff_reset)) {
+				backoff = CONFIG_COO_MQTT_BACKOFF_MIN_MS;
+			} else {
+				backoff = MIN(backoff * 2, CONFIG_COO_MQTT_BACKOFF_MAX_MS);
+			}
+		}
+		attempts++;
+
+		rc = coo_mqtt_broker_next(&broker);
+		if (rc != 0) {
+			LOG_DBG("No broker address yet");
+			continue;
+		}
+
 		rc = mqtt_connect(client);
+		idle_hook();
 		if (rc != 0) {
-			LOG_ERR("MQTT Connect failed [%d]", rc);
-			k_msleep(MSECS_WAIT_RECONNECT);
+			/* Expected while the broker restarts; warn once per outage */
+			if (attempts == 1) {
+				LOG_WRN("MQTT Connect failed [%d], retrying", rc);
+			} else {
+				LOG_DBG("MQTT Connect attempt %d failed [%d]", attempts, rc);
+			}
+			coo_mqtt_broker_report(&broker, false);
 			continue;
 		}
 
 		/* Poll MQTT socket for response */
-		rc = poll_mqtt_socket(client, MSECS_NET_POLL_TIMEOUT);
+		rc = poll_mqtt_socket(client, CONFIG_COO_MQTT_CONNACK_TIMEOUT_MS, false);
 		if (rc > 0) {
 			mqtt_input(client);
 		}
 
 		if (!mqtt_connected) {
+			LOG_DBG("No CONNACK on attempt %d", attempts);
 			mqtt_abort(client);
+			coo_mqtt_broker_report(&broker, false);
 		}
 	}
+
+	coo_mqtt_broker_report(&broker, true);
+	stats.connect_time_ms = k_uptime_get() - start;
+	stats.connects++;
+	LOG_INF("Connected after %d attempt(s) in %u ms", attempts, stats.connect_time_ms);
+
+	inflight_resend(client);
 }
 
 int coo_mqtt_init(struct mqtt_client *client, const char *id_str)
 {
-	int rc;
-	uint8_t broker_ip[NET_IPV4_ADDR_LEN];
-	struct sockaddr_in *broker4;
-	struct addrinfo *result;
-	const struct addrinfo hints = {
-		.ai_family = AF_INET,
-		.ai_socktype = SOCK_STREAM
-	};
+	/* Resolution runs in the background; connect picks up whatever is known */
+	coo_mqtt_broker_init();
 
-	/* Resolve IP address of MQTT broker */
-	rc = getaddrinfo(CONFIG_COO_MQTT_BROKER_HOSTNAME,
-				CONFIG_COO_MQTT_BROKER_PORT, &hints, &result);
-	if (rc != 0) {
-		LOG_ERR("Failed to resolve broker hostname [%s]", gai_strerror(rc));
-		return -EIO;
-	}
-	if (result == NULL) {
-		LOG_ERR("Broker address not found");
-		return -ENOENT;
+	if (net_listener.cb == NULL) {
+		net_listener.cb = on_network_event;
+		coo_network_add_listener(&net_listener);
 	}
 
-	broker4 = (struct sockaddr_in *)&broker;
-	broker4->sin_addr.s_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr;
-	broker4->sin_family = AF_INET;
-	broker4->sin_port = ((struct sockaddr_in *)result->ai_addr)->sin_port;
-	freeaddrinfo(result);
-
-	/* Log resolved IP address */
-	inet_ntop(AF_INET, &broker4->sin_addr.s_addr, broker_ip, sizeof(broker_ip));
-	LOG_INF("Connecting to MQTT broker @ %s", broker_ip);
+#if defined(CONFIG_COO_MQTT_WAKEUP)
+	if (wake_fd < 0) {
+		wake_fd = zvfs_eventfd(0, ZVFS_EFD_NONBLOCK);
+		if (wake_fd < 0) {
+			LOG_WRN("No wake-up eventfd [%d]; relying on poll interval", errno);
+		}
+	}
+#endif
 
 	/* MQTT client configuration */
 	strncpy(client_id, id_str, sizeof(client_id) - 1);
@@ -379,6 +1014,14 @@ int coo_mqtt_init(struct mqtt_client *client, const char *id_str)
 	client->user_name = NULL;
 	client->protocol_version = MQTT_VERSION_5_0;
 
+#if defined(CONFIG_MQTT_VERSION_5_0)
+	/* Keep subscriptions and queued commands across reconnects */
+	if (CONFIG_COO_MQTT_SESSION_EXPIRY_S > 0) {
+		client->clean_session = 0;
+		client->prop.session_expiry_interval = CONFIG_COO_MQTT_SESSION_EXPIRY_S;
+	}
+#endif
+
 	/* MQTT buffers configuration */
 	client->rx_buf = rx_buffer;
 	client->rx_buf_size = sizeof(rx_buffer);
@@ -386,7 +1029,11 @@ int coo_mqtt_init(struct mqtt_client *client, const char *id_str)
 	client->tx_buf_size = sizeof(tx_buffer);
 
 	/* MQTT transport configuration */
+#if defined(CONFIG_COO_MQTT_TX_COALESCE)
+	client->transport.type = MQTT_TRANSPORT_CUSTOM;
+#else
 	client->transport.type = MQTT_TRANSPORT_NON_SECURE;
+#endif
 
 	return 0;
 }
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * TCP transport for the MQTT library that can hold back writes and send
+ * them as one segment. Plugged in through CONFIG_MQTT_LIB_CUSTOM_TRANSPORT;
+ * coo_mqtt_tx_cork()/coo_mqtt_tx_flush() bracket a batch of publishes.
+ */
+
+#include <coo_commons/mqtt_client.h>
+#include <zephyr/net/socket.h>
+#include <errno.h>
+#include <string.h>
+
+#include "mqtt_transport.h"
+
+static uint8_t coalesce_buf[CONFIG_COO_MQTT_TX_COALESCE_SIZE];
+static size_t coalesce_len;
+static bool corked;
+static uint32_t flushes;
+static uint32_t coalesced;
+
+static int send_all(int sock, const uint8_t *data, size_t len)
+{
+	while (len > 0) {
+		ssize_t rc = zsock_send(sock, data, len, 0);
+
+		if (rc < 0) {
+			return -errno;
+		}
+		data += rc;
+		len -= rc;
+	}
+	return 0;
+}
+
+static int coalesce_flush(struct mqtt_client *client)
+{
+	int rc;
+
+	if (coalesce_len == 0) {
+		return 0;
+	}
+
+	rc = send_all(client->transport.tcp.sock, coalesce_buf, coalesce_len);
+	coalesce_len = 0;
+	flushes++;
+	return rc;
+}
+
+/** Append to the batch, flushing first if it would overflow */
+static int coalesce_append(struct mqtt_client *client, const uint8_t *data, size_t len)
+{
+	int rc;
+
+	if (coalesce_len + len > sizeof(coalesce_buf)) {
+		rc = coalesce_flush(client);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	if (len > sizeof(coalesce_buf)) {
+		return send_all(client->transport.tcp.sock, data, len);
+	}
+
+	memcpy(&coalesce_buf[coalesce_len], data, len);
+	coalesce_len += len;
+	return 0;
+}
+
+int mqtt_client_custom_transport_connect(struct mqtt_client *client)
+{
+	const struct sockaddr *broker = client->broker;
+	int one = 1;
+	int sock;
+
+	sock = zsock_socket(broker->sa_family, SOCK_STREAM, IPPROTO_TCP);
+	if (sock < 0) {
+		return -errno;
+	}
+
+	/* Batching is done here; don't let Nagle delay the flushed segment */
+	(void)zsock_setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	if (zsock_connect(sock, broker, sizeof(struct sockaddr_in)) < 0) {
+		int err = -errno;
+
+		zsock_close(sock);
+		return err;
+	}
+
+	client->transport.tcp.sock = sock;
+	coalesce_len = 0;
+	corked = false;
+	return 0;
+}
+
+int mqtt_client_custom_transport_write(struct mqtt_client *client, const uint8_t *data,
+				       uint32_t datalen)
+{
+	if (corked) {
+		coalesced++;
+		return coalesce_append(client, data, datalen);
+	}
+	return send_all(client->transport.tcp.sock, data, datalen);
+}
+
+int mqtt_client_custom_transport_write_msg(struct mqtt_client *client,
+					   const struct msghdr *message)
+{
+	int rc;
+
+	if (!corked) {
+		/* Unbatched: one gathered send, like the stock TCP transport */
+		size_t total = 0;
+
+		for (size_t i = 0; i < message->msg_iovlen; i++) {
+			total += message->msg_iov[i].iov_len;
+		}
+
+		ssize_t sent = zsock_sendmsg(client->transport.tcp.sock, message, 0);
+
+		if (sent < 0) {
+			return -errno;
+		}
+		if (sent == total) {
+			return 0;
+		}
+		/* Short send: fall through and push the remainder piecewise */
+		for (size_t i = 0; i < message->msg_iovlen; i++) {
+			size_t len = message->msg_iov[i].iov_len;
+
+			if (sent >= len) {
+				sent -= len;
+				continue;
+			}
+			rc = send_all(client->transport.tcp.sock,
+				      (const uint8_t *)message->msg_iov[i].iov_base + sent,
+				      len - sent);
+			if (rc != 0) {
+				return rc;
+			}
+			sent = 0;
+		}
+		return 0;
+	}
+
+	coalesced++;
+	for (size_t i = 0; i < message->msg_iovlen; i++) {
+		rc = coalesce_append(client, message->msg_iov[i].iov_base,
+				     message->msg_iov[i].iov_len);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+	return 0;
+}
+
+int mqtt_client_custom_transport_read(struct mqtt_client *client, uint8_t *data,
+				      uint32_t buflen, bool shall_block)
+{
+	ssize_t rc;
+
+	rc = zsock_recv(client->transport.tcp.sock, data, buflen,
+			shall_block ? 0 : ZSOCK_MSG_DONTWAIT);
+	if (rc < 0) {
+		return -errno;
+	}
+	return rc;
+}
+
+int mqtt_client_custom_transport_disconnect(struct mqtt_client *client)
+{
+	coalesce_len = 0;
+	corked = false;
+	return zsock_close(client->transport.tcp.sock) < 0 ? -errno : 0;
+}
+
+void coo_mqtt_tx_cork(void)
+{
+	corked = true;
+}
+
+int coo_mqtt_tx_flush(struct mqtt_client *client)
+{
+	corked = false;
+	return coalesce_flush(client);
+}
+
+int coo_mqtt_transport_write_msg(struct mqtt_client *client, const struct msghdr *message)
+{
+	return mqtt_client_custom_transport_write_msg(client, message);
+}
+
+void coo_mqtt_transport_stats(struct coo_mqtt_stats *stats)
+{
+	stats->tx_packets = coalesced;
+	stats->tx_sends = flushes;
+}
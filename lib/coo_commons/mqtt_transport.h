@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Internal interface between mqtt_client.c and mqtt_transport.c
+ */
+
+#ifndef COO_COMMONS_MQTT_TRANSPORT_H
+#define COO_COMMONS_MQTT_TRANSPORT_H
+
+#include <coo_commons/mqtt_client.h>
+
+/** Fill in the coalescing counters of @p stats */
+void coo_mqtt_transport_stats(struct coo_mqtt_stats *stats);
+
+/** Write a pre-encoded packet, joining the current batch when corked */
+int coo_mqtt_transport_write_msg(struct mqtt_client *client, const struct msghdr *message);
+
+#endif /* COO_COMMONS_MQTT_TRANSPORT_H */
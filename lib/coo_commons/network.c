@@ -22,10 +22,29 @@ LOG_MODULE_REGISTER(coo_network, LOG_LEVEL_DBG);
 /* Network connection management */
 static volatile bool network_online = false;
 static coo_network_event_cb_t user_event_cb = NULL;
+static sys_slist_t listeners = SYS_SLIST_STATIC_INIT(&listeners);
 
 #define NET_L4_EVENT_MASK (NET_EVENT_L4_CONNECTED | NET_EVENT_L4_DISCONNECTED)
 static struct net_mgmt_event_callback net_l4_mgmt_cb;
 
+static void notify_listeners(bool connected)
+{
+	struct coo_network_listener *listener;
+
+	if (user_event_cb) {
+		user_event_cb(connected);
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&listeners, listener, node) {
+		listener->cb(connected);
+	}
+}
+
+void coo_network_add_listener(struct coo_network_listener *listener)
+{
+	sys_slist_append(&listeners, &listener->node);
+}
+
 static void net_l4_evt_handler(struct net_mgmt_event_callback *cb,
                                 uint32_t mgmt_event,
                                 struct net_if *iface)
@@ -34,16 +53,12 @@ static void net_l4_evt_handler(struct net_mgmt_event_callback *cb,
 	case NET_EVENT_L4_CONNECTED:
 		network_online = true;
 		LOG_INF("Network up!");
-		if (user_event_cb) {
-			user_event_cb(true);
-		}
+		notify_listeners(true);
 		break;
 	case NET_EVENT_L4_DISCONNECTED:
 		network_online = false;
 		LOG_INF("Network down!");
-		if (user_event_cb) {
-			user_event_cb(false);
-		}
+		notify_listeners(false);
 		break;
 	default:
 		break;
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+# Copyright (c) 2025 Caltech Optical Observatories
+# SPDX-License-Identifier: Apache-2.0
+
+'''reconnect_bench.py
+
+Measures how quickly the HiSPEC-TIB gets back onto the broker after the
+broker restarts.
+
+Runs a local mosquitto (scripts/native_sim/mosquitto.conf by default),
+optionally launches a native_sim build, waits for photodiode telemetry,
+then repeatedly stops the broker for --down seconds and starts it again.
+For each cycle it reports the time from the broker accepting connections
+to the first telemetry message, and reads the device's own "conn"
+counters (connections, duration of the last connect) from the "stats"
+command. The broker connection, stats query and JSON output come from
+tib_bench.py, and --baseline compares against an earlier run the same way.
+
+Example:
+
+    ./reconnect_bench.py --launch build/zephyr/zephyr.exe --cycles 10 \\
+        --down 2 -o reconnect.json
+
+    # after a change, fail if recovery got more than 10% slower
+    ./reconnect_bench.py --launch build/zephyr/zephyr.exe --cycles 10 \\
+        --down 2 --baseline reconnect.json
+'''
+
+import argparse
+import json
+import os
+import socket
+import statistics
+import subprocess
+import sys
+import time
+
+from tib_bench import Session, git_revision, launch, regression, terminate, write_result
+
+DEFAULT_CONF = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            '..', 'native_sim', 'mosquitto.conf')
+
+
+def wait_port(host, port, timeout):
+    '''Return once the broker accepts TCP connections.'''
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        try:
+            with socket.create_connection((host, port), timeout=0.1):
+                return True
+        except OSError:
+            time.sleep(0.005)
+    return False
+
+
+class Broker:
+    def __init__(self, args):
+        self.args = args
+        self.proc = None
+
+    def start(self):
+        self.proc = subprocess.Popen([self.args.mosquitto, '-c', self.args.conf],
+                                     stdout=subprocess.DEVNULL,
+                                     stderr=subprocess.DEVNULL)
+        if not wait_port(self.args.broker, self.args.port, 5.0):
+            raise RuntimeError('broker did not come up')
+        return time.monotonic()
+
+    def stop(self):
+        if self.proc:
+            self.proc.terminate()
+            self.proc.wait(timeout=5)
+            self.proc = None
+
+
+class Observer(Session):
+    '''Tracks telemetry arrival across broker restarts.'''
+
+    def __init__(self, args):
+        super().__init__(args, 'reconnect')
+        self.last_telemetry = None
+        self.client.reconnect_delay_set(min_delay=0.01, max_delay=0.05)
+
+    def on_telemetry(self, now):
+        with self.lock:
+            self.last_telemetry = now
+            self.lock.notify_all()
+
+    def wait_telemetry(self, after, timeout):
+        '''Return the arrival time of the first telemetry message after "after".'''
+        deadline = time.monotonic() + timeout
+        with self.lock:
+            while self.last_telemetry is None or self.last_telemetry < after:
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    return None
+                self.lock.wait(remaining)
+            return self.last_telemetry
+
+    def query_conn(self):
+        '''Return the device's [connections, last connect ms], or None.'''
+        stats = self.query_stats(2.0)
+        return stats.get('mqtt', {}).get('conn') if stats else None
+
+
+def summarize(values):
+    if not values:
+        return None
+    ordered = sorted(values)
+    return {
+        'min': round(ordered[0], 1),
+        'p50': round(statistics.median(ordered), 1),
+        'max': round(ordered[-1], 1),
+    }
+
+
+def run(args):
+    broker = Broker(args)
+    observer = Observer(args)
+    proc = None
+    cycles = []
+
+    broker.start()
+    try:
+        if args.launch:
+            proc = launch(args.launch)
+        observer.connect()
+        if observer.wait_telemetry(0, args.boot_wait) is None:
+            raise RuntimeError('no telemetry from the device')
+
+        for i in range(args.cycles):
+            broker.stop()
+            time.sleep(args.down)
+            up = broker.start()
+            seen = observer.wait_telemetry(up, args.timeout)
+            conn = observer.query_conn() if seen is not None else None
+            cycles.append({
+                'cycle': i,
+                'telemetry_ms': round((seen - up) * 1000.0, 1) if seen else None,
+                'device_conn': conn,
+            })
+            print(f'cycle {i}: {cycles[-1]}', file=sys.stderr)
+    finally:
+        observer.close()
+        terminate(proc)
+        broker.stop()
+
+    recovered = [c['telemetry_ms'] for c in cycles if c['telemetry_ms'] is not None]
+    connect_ms = [c['device_conn'][1] for c in cycles if c['device_conn']]
+    return {
+        'revision': git_revision(),
+        'timestamp': time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime()),
+        'config': {'cycles': args.cycles, 'down_s': args.down},
+        'failed': len(cycles) - len(recovered),
+        'telemetry_ms': summarize(recovered),
+        'device_connect_ms': summarize(connect_ms),
+        'cycles': cycles,
+    }
+
+
+def compare(result, baseline, max_regression):
+    '''Return a list of human-readable regressions against a baseline result.'''
+    problems = []
+    for key in ('telemetry_ms', 'device_connect_ms'):
+        new, old = result[key], baseline.get(key)
+        if not new or not old:
+            continue
+        for stat in ('p50', 'max'):
+            problem = regression(f'{key} {stat}', new[stat], old[stat], False, max_regression)
+            if problem:
+                problems.append(problem)
+    return problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--broker', default='localhost', help='broker host (default: %(default)s)')
+    parser.add_argument('--port', type=int, default=1883)
+    parser.add_argument('--mosquitto', default='mosquitto', help='broker executable')
+    parser.add_argument('--conf', default=DEFAULT_CONF, help='broker configuration file')
+    parser.add_argument('--cycles', type=int, default=5, help='number of broker restarts')
+    parser.add_argument('--down', type=float, default=1.0,
+                        help='seconds the broker stays down each cycle')
+    parser.add_argument('--timeout', type=float, default=30.0,
+                        help='seconds to wait for telemetry after a restart')
+    parser.add_argument('--launch', metavar='EXE',
+                        help='start this binary (e.g. native_sim zephyr.exe) for the run')
+    parser.add_argument('--boot-wait', type=float, default=15.0,
+                        help='seconds to wait for the first telemetry message')
+    parser.add_argument('-o', '--output', help='write the JSON result here (default: stdout)')
+    parser.add_argument('--baseline', help='previous JSON result to compare against')
+    parser.add_argument('--max-regression', type=float, default=0.10,
+                        help='allowed relative regression vs --baseline (default: %(default)s)')
+    args = parser.parse_args()
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    result = run(args)
+    write_result(result, args.output)
+
+    if result['failed']:
+        return 1
+    if baseline:
+        problems = compare(result, baseline, args.max_regression)
+        for problem in problems:
+            print(f'REGRESSION {problem}', file=sys.stderr)
+        return 1 if problems else 0
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,532 @@
+#!/usr/bin/env python3
+# Copyright (c) 2025 Caltech Optical Observatories
+# SPDX-License-Identifier: Apache-2.0
+
+'''tib_bench.py
+
+End-to-end MQTT load generator for the HiSPEC-TIB.
+
+Drives a TIB (native_sim build or real board) through a broker with a
+configurable command mix, concurrency and payload size while listening to
+the photodiode telemetry stream, and reports throughput, latency
+percentiles, busy rejections and dropped telemetry as JSON so results can
+be compared commit to commit. Device-side counters from the "stats"
+command (MQTT loop wake-ups per second, queue-to-wire latency) are read
+before and after the load phase and included when the firmware has them.
+
+Example:
+
+    # native_sim build, local broker from scripts/native_sim/mosquitto.conf
+    ./tib_bench.py --launch build/zephyr/zephyr.exe --duration 30 \\
+        --mix status:4,memsroute:2,atten:1 --concurrency 2 -o bench.json
+
+    # compare against a previous run, fail on >10% regression; the
+    # before/after figures are printed and kept under "baseline"
+    ./tib_bench.py --baseline bench.json --max-regression 0.10
+'''
+
+import argparse
+import json
+import os
+import random
+import signal
+import statistics
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+import paho.mqtt.client as mqtt
+from paho.mqtt.packettypes import PacketTypes
+from paho.mqtt.properties import Properties
+
+CMD_PREFIX = 'cmd/hsfib-tib/req/'
+TELEMETRY_TOPIC = 'dt/hsfib-tib/photodiode'
+DEFAULT_TELEMETRY_HZ = 50.0
+
+# name -> (topic suffix, JSON body without padding)
+COMMANDS = {
+    'status':    ('status', {'msg_type': 'get'}),
+    'power':     ('power', {'msg_type': 'get'}),
+    'memsroute': ('memsroute', {'msg_type': 'get'}),
+    'mems':      ('mems/yj_ao_fei', {'msg_type': 'get'}),
+    'atten':     ('atten1430yj/value', {'msg_type': 'get'}),
+    'route_set': ('memsroute', {'msg_type': 'set', 'input': 'yj_cal', 'output': 'yj_ao'}),
+    'mems_set':  ('mems/yj_mm_sm', {'msg_type': 'set', 'value': 'A'}),
+    'atten_set': ('atten1430yj/value', {'msg_type': 'set', 'value': 1.0}),
+}
+
+
+def parse_mix(text):
+    '''Parse "status:4,memsroute:1" into a list of (name, weight).'''
+    mix = []
+    for item in text.split(','):
+        name, _, weight = item.partition(':')
+        name = name.strip()
+        if name not in COMMANDS:
+            raise argparse.ArgumentTypeError(
+                f'unknown command "{name}", choose from {", ".join(COMMANDS)}')
+        mix.append((name, float(weight) if weight else 1.0))
+    return mix
+
+
+def percentile(values, pct):
+    if not values:
+        return None
+    ordered = sorted(values)
+    k = (len(ordered) - 1) * pct / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(ordered) - 1)
+    return ordered[lo] + (ordered[hi] - ordered[lo]) * (k - lo)
+
+
+def regression(label, new, old, higher_is_better, max_regression):
+    '''Describe a change from "old" to "new" beyond max_regression, or None.'''
+    if new is None or old is None or old == 0:
+        return None
+    change = (new - old) / old
+    if (higher_is_better and change < -max_regression) or \
+       (not higher_is_better and change > max_regression):
+        return f'{label}: {old} -> {new} ({change:+.1%})'
+    return None
+
+
+def launch(exe):
+    '''Start a native_sim binary in its own session.'''
+    return subprocess.Popen([exe], stdout=subprocess.DEVNULL,
+                            stderr=subprocess.DEVNULL, start_new_session=True)
+
+
+def terminate(proc):
+    if proc:
+        os.killpg(proc.pid, signal.SIGTERM)
+        proc.wait(timeout=5)
+
+
+def write_result(result, path):
+    '''Write a JSON result to "path", or stdout when it is None.'''
+    text = json.dumps(result, indent=2)
+    if path:
+        with open(path, 'w') as f:
+            f.write(text + '\n')
+    else:
+        print(text)
+
+
+def git_revision():
+    try:
+        return subprocess.check_output(['git', 'rev-parse', '--short', 'HEAD'],
+                                       stderr=subprocess.DEVNULL,
+                                       cwd=os.path.dirname(os.path.abspath(__file__))
+                                       ).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+class Session:
+    '''Broker connection shared by the benchmarks.
+
+    Subscribes to the photodiode telemetry and a private response topic,
+    answers "stats" queries by correlation ID and hands everything else to
+    on_telemetry() and on_response().
+    '''
+
+    def __init__(self, args, name):
+        self.args = args
+        self.resp_topic = f'bench/{os.getpid()}/{name}'
+
+        self.lock = threading.Condition()
+        self.next_id = 0
+        self.stats_waiters = {}        # corr id -> [threading.Event, payload]
+
+        self.client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2,
+                                  client_id=f'tib-{name}-{os.getpid()}',
+                                  protocol=mqtt.MQTTv5)
+        self.client.on_connect = self.on_connect
+        self.client.on_message = self.on_message
+        self.connected = threading.Event()
+
+    # ---- MQTT callbacks -------------------------------------------------
+
+    def on_connect(self, client, userdata, flags, reason_code, properties):
+        client.subscribe(self.resp_topic, qos=1)
+        client.subscribe(TELEMETRY_TOPIC, qos=0)
+        self.connected.set()
+
+    def on_message(self, client, userdata, msg):
+        now = time.monotonic()
+        if msg.topic == TELEMETRY_TOPIC:
+            self.on_telemetry(now)
+            return
+
+        corr = getattr(msg.properties, 'CorrelationData', None)
+        if not corr or len(corr) != 8:
+            return
+        (corr_id,) = struct.unpack('<Q', corr)
+
+        with self.lock:
+            waiter = self.stats_waiters.pop(corr_id, None)
+            if waiter is not None:
+                waiter[1] = msg.payload
+                waiter[0].set()
+                return
+            self.on_response(corr_id, msg.payload, now)
+
+    def on_telemetry(self, now):
+        pass
+
+    def on_response(self, corr_id, payload, now):
+        '''A reply to one of our commands.  Called with the lock held.'''
+
+    # ---- requests -------------------------------------------------------
+
+    def alloc_id(self):
+        '''Next correlation ID.  Called with the lock held.'''
+        corr_id = self.next_id
+        self.next_id += 1
+        return corr_id
+
+    def query_stats(self, timeout):
+        '''Fetch the device "stats" document, or None.'''
+        props = Properties(PacketTypes.PUBLISH)
+        props.ResponseTopic = self.resp_topic
+        waiter = [threading.Event(), None]
+
+        with self.lock:
+            corr_id = self.alloc_id()
+            self.stats_waiters[corr_id] = waiter
+        props.CorrelationData = struct.pack('<Q', corr_id)
+
+        self.client.publish(CMD_PREFIX + 'stats', '{"msg_type":"get"}', qos=1, properties=props)
+        if not waiter[0].wait(timeout=timeout):
+            with self.lock:
+                self.stats_waiters.pop(corr_id, None)
+            return None
+        try:
+            stats = json.loads(waiter[1])
+        except ValueError:
+            return None
+        return stats if isinstance(stats, dict) else None
+
+    def connect(self):
+        self.client.connect(self.args.broker, self.args.port, keepalive=30)
+        self.client.loop_start()
+        if not self.connected.wait(timeout=10):
+            self.close()
+            raise RuntimeError(f'could not connect to broker {self.args.broker}')
+
+    def close(self):
+        self.client.loop_stop()
+        self.client.disconnect()
+
+
+class Bench(Session):
+    def __init__(self, args):
+        super().__init__(args, 'bench')
+        self.mix_names = [name for name, _ in args.mix]
+        self.mix_weights = [weight for _, weight in args.mix]
+
+        self.outstanding = {}          # corr id -> (send time, command name)
+        self.latencies = {name: [] for name in COMMANDS}
+        self.sent = 0
+        self.completed = 0
+        self.busy = 0
+        self.errors = 0
+        self.timeouts = 0
+
+        self.telemetry_times = []
+        self.telemetry_started = None
+
+        self.client.max_inflight_messages_set(max(20, args.concurrency * 2))
+
+    def on_telemetry(self, now):
+        with self.lock:
+            if self.telemetry_started is not None:
+                self.telemetry_times.append(now)
+
+    def on_response(self, corr_id, payload, now):
+        entry = self.outstanding.pop(corr_id, None)
+        if entry is None:
+            return
+        sent_at, name = entry
+        self.completed += 1
+        self.latencies[name].append((now - sent_at) * 1000.0)
+        payload = payload.decode(errors='replace')
+        if '"busy"' in payload:
+            self.busy += 1
+        elif '"error"' in payload:
+            self.errors += 1
+        self.lock.notify_all()
+
+    # ---- load generation ------------------------------------------------
+
+    def build_payload(self, name):
+        _, body = COMMANDS[name]
+        body = dict(body)
+        if self.args.payload_size:
+            base = len(json.dumps(body))
+            body['pad'] = 'x' * max(0, self.args.payload_size - base - len(',"pad":""'))
+        return json.dumps(body, separators=(',', ':'))
+
+    def send_one(self):
+        name = random.choices(self.mix_names, weights=self.mix_weights)[0]
+        suffix, _ = COMMANDS[name]
+
+        props = Properties(PacketTypes.PUBLISH)
+        props.ResponseTopic = self.resp_topic
+
+        with self.lock:
+            corr_id = self.alloc_id()
+            props.CorrelationData = struct.pack('<Q', corr_id)
+            self.outstanding[corr_id] = (time.monotonic(), name)
+            self.sent += 1
+
+        self.client.publish(CMD_PREFIX + suffix, self.build_payload(name),
+                            qos=self.args.qos, properties=props)
+
+    def expire_outstanding(self, now):
+        '''Count requests that never got an answer.  Called with the lock held.'''
+        deadline = now - self.args.timeout
+        expired = [cid for cid, (t, _) in self.outstanding.items() if t < deadline]
+        for cid in expired:
+            del self.outstanding[cid]
+            self.timeouts += 1
+        if expired:
+            self.lock.notify_all()
+
+    def run_load(self):
+        interval = 1.0 / self.args.rate if self.args.rate > 0 else 0.0
+        start = time.monotonic()
+        end = start + self.args.duration
+        next_send = start
+
+        with self.lock:
+            self.telemetry_started = start
+
+        while True:
+            now = time.monotonic()
+            if now >= end:
+                break
+            with self.lock:
+                self.expire_outstanding(now)
+                if len(self.outstanding) >= self.args.concurrency:
+                    self.lock.wait(timeout=0.05)
+                    continue
+            if interval:
+                if now < next_send:
+                    time.sleep(min(next_send - now, end - now))
+                    continue
+                next_send += interval
+            self.send_one()
+
+        # Let the last requests drain
+        drain_end = time.monotonic() + self.args.timeout
+        with self.lock:
+            while self.outstanding and time.monotonic() < drain_end:
+                self.lock.wait(timeout=0.05)
+            self.expire_outstanding(float('inf'))
+            telemetry_window = time.monotonic() - start
+            self.telemetry_started = None
+
+        return time.monotonic() - start, telemetry_window
+
+    # ---- reporting ------------------------------------------------------
+
+    @staticmethod
+    def device_summary(before, after, elapsed):
+        '''Derive per-second rates and latencies from two stats snapshots.'''
+        if not before or not after or 'queues' not in after:
+            return None
+        summary = {}
+        if 'wakeups' in before and 'wakeups' in after and elapsed:
+            summary['wakeups_per_s'] = round((after['wakeups'] - before['wakeups']) / elapsed, 1)
+        for name in ('response', 'telemetry'):
+            lat = after['queues'].get(name, {}).get('lat_us')
+            if lat:
+                summary[f'{name}_queue_lat_us'] = {'avg': lat[0], 'max': lat[1]}
+        return summary
+
+    def report(self, elapsed, telemetry_window, device=None):
+        all_lat = [v for values in self.latencies.values() for v in values]
+
+        def lat_summary(values):
+            if not values:
+                return None
+            return {
+                'count': len(values),
+                'mean': round(statistics.fmean(values), 3),
+                'p50': round(percentile(values, 50), 3),
+                'p90': round(percentile(values, 90), 3),
+                'p99': round(percentile(values, 99), 3),
+                'max': round(max(values), 3),
+            }
+
+        expected = telemetry_window * self.args.telemetry_hz
+        received = len(self.telemetry_times)
+        gaps = [(b - a) * 1000.0 for a, b in zip(self.telemetry_times, self.telemetry_times[1:])]
+
+        return {
+            'revision': git_revision(),
+            'timestamp': time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime()),
+            'config': {
+                'broker': f'{self.args.broker}:{self.args.port}',
+                'duration_s': self.args.duration,
+                'rate': self.args.rate,
+                'concurrency': self.args.concurrency,
+                'qos': self.args.qos,
+                'payload_size': self.args.payload_size,
+                'mix': dict(self.args.mix),
+            },
+            'commands': {
+                'sent': self.sent,
+                'completed': self.completed,
+                'timeouts': self.timeouts,
+                'busy': self.busy,
+                'errors': self.errors,
+                'busy_rate': round(self.busy / self.sent, 4) if self.sent else 0.0,
+                'throughput_cps': round(self.completed / elapsed, 2) if elapsed else 0.0,
+                'latency_ms': lat_summary(all_lat),
+                'latency_ms_by_command': {name: lat_summary(values)
+                                          for name, values in self.latencies.items() if values},
+            },
+            'telemetry': {
+                'received': received,
+                'expected': int(expected),
+                'dropped': max(0, int(round(expected)) - received),
+                'drop_rate': round(max(0.0, 1.0 - received / expected), 4) if expected else 0.0,
+                'rate_hz': round(received / telemetry_window, 2) if telemetry_window else 0.0,
+                'gap_ms_p99': round(percentile(gaps, 99), 3) if gaps else None,
+                'gap_ms_max': round(max(gaps), 3) if gaps else None,
+            },
+            'device': device,
+        }
+
+    def run(self):
+        self.connect()
+        try:
+            if self.args.warmup:
+                time.sleep(self.args.warmup)
+            before = self.query_stats(self.args.timeout)
+            stats_start = time.monotonic()
+            elapsed, window = self.run_load()
+            after = self.query_stats(self.args.timeout)
+            device = self.device_summary(before, after, time.monotonic() - stats_start)
+            return self.report(elapsed, window, device)
+        finally:
+            self.close()
+
+
+# (label, path into the result, higher is better, fails the run on regression).
+# The device rows need firmware that reports wake-ups and queue latency.
+TRACKED = [
+    ('throughput_cps', ('commands', 'throughput_cps'), True, True),
+    ('latency p50', ('commands', 'latency_ms', 'p50'), False, True),
+    ('latency p99', ('commands', 'latency_ms', 'p99'), False, True),
+    ('telemetry rate_hz', ('telemetry', 'rate_hz'), True, True),
+    ('telemetry gap_ms_p99', ('telemetry', 'gap_ms_p99'), False, False),
+    ('telemetry gap_ms_max', ('telemetry', 'gap_ms_max'), False, False),
+    ('wakeups_per_s', ('device', 'wakeups_per_s'), False, False),
+    ('telemetry queue avg_us', ('device', 'telemetry_queue_lat_us', 'avg'), False, False),
+    ('telemetry queue max_us', ('device', 'telemetry_queue_lat_us', 'max'), False, False),
+]
+
+
+def lookup(doc, path):
+    for key in path:
+        if not isinstance(doc, dict):
+            return None
+        doc = doc.get(key)
+    return doc
+
+
+def changes(result, baseline):
+    '''(label, old, new) for every tracked metric both runs report.'''
+    rows = []
+    for label, path, _, _ in TRACKED:
+        old, new = lookup(baseline, path), lookup(result, path)
+        if old is not None and new is not None:
+            rows.append((label, old, new))
+    return rows
+
+
+def compare(result, baseline, max_regression):
+    '''Return a list of human-readable regressions against a baseline result.'''
+    problems = []
+    for label, path, higher_is_better, gate in TRACKED:
+        if not gate:
+            continue
+        problem = regression(label, lookup(result, path), lookup(baseline, path),
+                             higher_is_better, max_regression)
+        if problem:
+            problems.append(problem)
+    return problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--broker', default='localhost', help='broker host (default: %(default)s)')
+    parser.add_argument('--port', type=int, default=1883)
+    parser.add_argument('--duration', type=float, default=20.0, help='load phase in seconds')
+    parser.add_argument('--warmup', type=float, default=2.0,
+                        help='seconds to wait after connecting before measuring')
+    parser.add_argument('--rate', type=float, default=0.0,
+                        help='target commands per second, 0 = as fast as the window allows')
+    parser.add_argument('--concurrency', type=int, default=1,
+                        help='maximum outstanding commands')
+    parser.add_argument('--mix', type=parse_mix, default=parse_mix('status'),
+                        help='weighted command mix, e.g. status:4,memsroute:1 '
+                             f'(commands: {", ".join(COMMANDS)})')
+    parser.add_argument('--payload-size', type=int, default=0,
+                        help='pad request payloads to this many bytes')
+    parser.add_argument('--qos', type=int, choices=(0, 1, 2), default=1)
+    parser.add_argument('--timeout', type=float, default=5.0,
+                        help='seconds before an unanswered command counts as a timeout')
+    parser.add_argument('--telemetry-hz', type=float, default=DEFAULT_TELEMETRY_HZ,
+                        help='expected photodiode publish rate (default: %(default)s)')
+    parser.add_argument('--launch', metavar='EXE',
+                        help='start this binary (e.g. native_sim zephyr.exe) for the run')
+    parser.add_argument('--boot-wait', type=float, default=5.0,
+                        help='seconds to wait after --launch before connecting')
+    parser.add_argument('-o', '--output', help='write the JSON result here (default: stdout)')
+    parser.add_argument('--baseline', help='previous JSON result to compare against')
+    parser.add_argument('--max-regression', type=float, default=0.10,
+                        help='allowed relative regression vs --baseline (default: %(default)s)')
+    args = parser.parse_args()
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    proc = None
+    if args.launch:
+        proc = launch(args.launch)
+        time.sleep(args.boot_wait)
+
+    try:
+        result = Bench(args).run()
+    finally:
+        terminate(proc)
+
+    if baseline:
+        # Keep the before/after figures with the result
+        result['baseline'] = {
+            'revision': baseline.get('revision'),
+            'changes': {label: [old, new] for label, old, new in changes(result, baseline)},
+        }
+    write_result(result, args.output)
+
+    if baseline:
+        for label, old, new in changes(result, baseline):
+            print(f'{label:24} {old:>10} -> {new}', file=sys.stderr)
+        problems = compare(result, baseline, args.max_regression)
+        for problem in problems:
+            print(f'REGRESSION {problem}', file=sys.stderr)
+        return 1 if problems else 0
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file test the MEMS switch and attenuator paths against the emulators
+ *
+ * Checks what reached the emulated PCAL6416A and DAC7578, and that each
+ * I2C transaction is timed once.
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/drivers/emul.h>
+
+#include <app/drivers/tib_emul.h>
+
+#include "attenuator.h"
+#include "devices.h"
+#include "metrics.h"
+#include "mems_switching.h"
+
+/* Normally defined by devices.c, which also brings up Modbus */
+const struct device *dac_dev = DEVICE_DT_GET(DT_NODELABEL(dac7578));
+
+/* metrics.c needs the MQTT stack; count the records instead */
+static uint32_t i2c_records[METRICS_I2C_COUNT];
+
+void metrics_i2c_record(enum metrics_i2c dev, uint32_t usec)
+{
+	ARG_UNUSED(usec);
+	i2c_records[dev]++;
+}
+
+static const struct device *const gpio = DEVICE_DT_GET(DT_NODELABEL(pcal6416a));
+static const struct emul *const gpio_emul = EMUL_DT_GET(DT_NODELABEL(pcal6416a));
+static const struct emul *const dac_emul = EMUL_DT_GET(DT_NODELABEL(dac7578));
+
+#define PIN_A 4
+#define PIN_B 5
+
+ZTEST(actuation, test_mems_pulse)
+{
+	struct mems_switch sw;
+	uint32_t a = tib_emul_pcal64xxa_pulses(gpio_emul, PIN_A);
+	uint32_t b = tib_emul_pcal64xxa_pulses(gpio_emul, PIN_B);
+	uint32_t writes = i2c_records[METRICS_I2C_GPIO];
+	char state;
+
+	mems_switch_init(&sw, gpio, PIN_A, PIN_B, "test");
+
+	/* One pulse on the selected coil only, which is left de-energized */
+	zassert_ok(mems_switch_set_state(&sw, 'B'));
+	zassert_equal(tib_emul_pcal64xxa_pulses(gpio_emul, PIN_A), a);
+	zassert_equal(tib_emul_pcal64xxa_pulses(gpio_emul, PIN_B), b + 1);
+	zassert_equal(tib_emul_pcal64xxa_get_output(gpio_emul, PIN_B), 0);
+
+	zassert_ok(mems_switch_set_state(&sw, 'A'));
+	zassert_equal(tib_emul_pcal64xxa_pulses(gpio_emul, PIN_A), a + 1);
+	zassert_equal(tib_emul_pcal64xxa_pulses(gpio_emul, PIN_B), b + 1);
+	zassert_equal(tib_emul_pcal64xxa_get_output(gpio_emul, PIN_A), 0);
+	zassert_ok(mems_switch_get_state(&sw, &state));
+	zassert_equal(state, 'A');
+
+	/* Three pin writes per pulse */
+	zassert_equal(i2c_records[METRICS_I2C_GPIO] - writes, 6);
+
+	zassert_true(mems_switch_set_state(&sw, 'X') != 0, "invalid state accepted");
+	zassert_equal(tib_emul_pcal64xxa_pulses(gpio_emul, PIN_A), a + 1);
+}
+
+ZTEST(actuation, test_attenuator_dac_code)
+{
+	struct attenuator att = {0};
+	uint32_t writes = i2c_records[METRICS_I2C_DAC];
+	uint16_t code;
+
+	attenuator_init(&att, 2);
+
+	/* Half of the 4.096 V range, truncated to 12 bits */
+	zassert_true(attenuator_set(&att, 2.048, true));
+	zassert_ok(tib_emul_dac7578_get_code(dac_emul, 2, &code));
+	zassert_equal(code, 2047);
+
+	/* Clamped to the DAC range */
+	zassert_true(attenuator_set(&att, 5.0, true));
+	zassert_ok(tib_emul_dac7578_get_code(dac_emul, 2, &code));
+	zassert_equal(code, 4095);
+	zassert_true(attenuator_set(&att, -1.0, true));
+	zassert_ok(tib_emul_dac7578_get_code(dac_emul, 2, &code));
+	zassert_equal(code, 0);
+
+	/* dB through the db2volt curve: 1 V + 0.5 V/dB at 2 dB is 2 V */
+	att.coeff_db_to_volt[0] = 1.0;
+	att.coeff_db_to_volt[1] = 0.5;
+	zassert_true(attenuator_set(&att, 2.0, false));
+	zassert_ok(tib_emul_dac7578_get_code(dac_emul, 2, &code));
+	zassert_equal(code, 1999);
+
+	/* One timed write per setting */
+	zassert_equal(i2c_records[METRICS_I2C_DAC] - writes, 4);
+
+	/* Other channels untouched */
+	zassert_ok(tib_emul_dac7578_get_code(dac_emul, 3, &code));
+	zassert_equal(code, 0);
+}
+
+ZTEST_SUITE(actuation, NULL, NULL, NULL, NULL, NULL);
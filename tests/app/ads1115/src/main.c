@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file test the ADS1115 RTIO conversions against the emulator
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/drivers/emul.h>
+
+#include <app/drivers/tib_emul.h>
+
+#include "ads1115.h"
+#include "metrics.h"
+
+/* metrics.c needs the MQTT stack; ads1115.c only reports bus time to it */
+void metrics_i2c_record(enum metrics_i2c dev, uint32_t usec)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(usec);
+}
+
+static const struct emul *const adc_emul = EMUL_DT_GET(DT_NODELABEL(adc1115));
+
+ZTEST(ads1115, test_ready_probes_once)
+{
+	uint32_t conversions = tib_emul_ads1x1x_conversions(adc_emul);
+
+	/* Reading the config register answers the probe without converting */
+	zassert_true(ads1115_ready());
+	zassert_true(ads1115_ready());
+	zassert_equal(tib_emul_ads1x1x_conversions(adc_emul), conversions);
+}
+
+ZTEST(ads1115, test_convert)
+{
+	int16_t yj, hk;
+	struct ads1115_conv conv[] = {
+		{ .ain = 0, .pga = 0, .period_us = 1163, .result = &yj },
+		{ .ain = 1, .pga = 2, .period_us = 1163, .result = &hk },
+	};
+	uint32_t conversions = tib_emul_ads1x1x_conversions(adc_emul);
+
+	zassert_true(ads1115_ready());
+	zassert_ok(tib_emul_ads1x1x_set_input(adc_emul, 0, 1000000));
+	zassert_ok(tib_emul_ads1x1x_set_input(adc_emul, 1, 500000));
+
+	/* Both channels in one submission, each on its own range */
+	zassert_ok(ads1115_convert(conv, ARRAY_SIZE(conv)));
+	zassert_equal(yj, 5333, "1 V of +/-6.144 V read as %d", yj);
+	zassert_equal(hk, 8000, "0.5 V of +/-2.048 V read as %d", hk);
+	zassert_equal(tib_emul_ads1x1x_conversions(adc_emul) - conversions, 2);
+}
+
+ZTEST(ads1115, test_limits)
+{
+	int16_t sample;
+	struct ads1115_conv conv = {
+		.ain = 2, .pga = 5, .period_us = 7813, .result = &sample,
+	};
+	struct ads1115_conv too_many[ADS1115_MAX_CONV + 1];
+
+	/* 1 V saturates the +/-256 mV range */
+	zassert_ok(tib_emul_ads1x1x_set_input(adc_emul, 2, 1000000));
+	zassert_ok(ads1115_convert(&conv, 1));
+	zassert_equal(sample, INT16_MAX);
+
+	zassert_equal(ads1115_convert(&conv, 0), -EINVAL);
+	for (size_t i = 0; i < ARRAY_SIZE(too_many); i++) {
+		too_many[i] = conv;
+	}
+	zassert_equal(ads1115_convert(too_many, ARRAY_SIZE(too_many)), -EINVAL);
+}
+
+ZTEST_SUITE(ads1115, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file test the TIB emulators behind the stock Zephyr drivers
+ *
+ * This suite drives the PCAL6416A, DAC7578 and ADS1115 through the Zephyr
+ * GPIO, DAC and ADC APIs on native_sim and checks what the emulators saw.
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/drivers/dac.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/gpio.h>
+
+#include <app/drivers/tib_emul.h>
+
+static const struct device *const gpio = DEVICE_DT_GET(DT_NODELABEL(pcal6416a));
+static const struct device *const dac = DEVICE_DT_GET(DT_NODELABEL(dac7578));
+static const struct device *const adc = DEVICE_DT_GET(DT_NODELABEL(adc1115));
+static const struct emul *const gpio_emul = EMUL_DT_GET(DT_NODELABEL(pcal6416a));
+static const struct emul *const dac_emul = EMUL_DT_GET(DT_NODELABEL(dac7578));
+static const struct emul *const adc_emul = EMUL_DT_GET(DT_NODELABEL(adc1115));
+
+/* +/-6.144 V on AIN0 and AIN1, as the application reads them */
+static const struct adc_channel_cfg ch0_cfg =
+	ADC_CHANNEL_CFG_DT(DT_CHILD(DT_NODELABEL(adc1115), channel_0));
+static const struct adc_channel_cfg ch1_cfg =
+	ADC_CHANNEL_CFG_DT(DT_CHILD(DT_NODELABEL(adc1115), channel_1));
+
+#define PIN_A 4
+#define PIN_B 5
+
+ZTEST(tib_emul, test_gpio_pulse)
+{
+	uint32_t a = tib_emul_pcal64xxa_pulses(gpio_emul, PIN_A);
+	uint32_t b = tib_emul_pcal64xxa_pulses(gpio_emul, PIN_B);
+
+	zassert_true(device_is_ready(gpio));
+	zassert_ok(gpio_pin_configure(gpio, PIN_A, GPIO_OUTPUT_INACTIVE));
+	zassert_ok(gpio_pin_configure(gpio, PIN_B, GPIO_OUTPUT_INACTIVE));
+
+	/* A rising edge counts once, whatever else the port does */
+	zassert_ok(gpio_pin_set(gpio, PIN_B, 1));
+	zassert_equal(tib_emul_pcal64xxa_get_output(gpio_emul, PIN_B), 1);
+	zassert_ok(gpio_pin_set(gpio, PIN_B, 1));
+	zassert_ok(gpio_pin_set(gpio, PIN_B, 0));
+	zassert_equal(tib_emul_pcal64xxa_get_output(gpio_emul, PIN_B), 0);
+	zassert_equal(tib_emul_pcal64xxa_pulses(gpio_emul, PIN_B), b + 1);
+	zassert_equal(tib_emul_pcal64xxa_pulses(gpio_emul, PIN_A), a);
+}
+
+ZTEST(tib_emul, test_dac_code)
+{
+	struct dac_channel_cfg cfg = { .channel_id = 2, .resolution = 12 };
+	uint16_t code;
+
+	zassert_true(device_is_ready(dac));
+	zassert_ok(dac_channel_setup(dac, &cfg));
+
+	zassert_ok(dac_write_value(dac, 2, 2047));
+	zassert_ok(tib_emul_dac7578_get_code(dac_emul, 2, &code));
+	zassert_equal(code, 2047);
+	zassert_ok(dac_write_value(dac, 2, 4095));
+	zassert_ok(tib_emul_dac7578_get_code(dac_emul, 2, &code));
+	zassert_equal(code, 4095);
+
+	/* Other channels untouched */
+	zassert_ok(tib_emul_dac7578_get_code(dac_emul, 3, &code));
+	zassert_equal(code, 0);
+	zassert_equal(tib_emul_dac7578_get_code(dac_emul, 8, &code), -EINVAL);
+}
+
+static int16_t adc_sample(const struct adc_channel_cfg *cfg)
+{
+	int16_t sample = INT16_MIN;
+	struct adc_sequence seq = {
+		.channels = BIT(cfg->channel_id),
+		.buffer = &sample,
+		.buffer_size = sizeof(sample),
+		.resolution = 16,
+	};
+
+	zassert_ok(adc_channel_setup(adc, cfg));
+	zassert_ok(adc_read(adc, &seq));
+	return sample;
+}
+
+ZTEST(tib_emul, test_adc_read)
+{
+	uint32_t conversions = tib_emul_ads1x1x_conversions(adc_emul);
+	int16_t sample;
+
+	zassert_true(device_is_ready(adc));
+	zassert_ok(tib_emul_ads1x1x_set_input(adc_emul, 0, 1000000));
+	zassert_ok(tib_emul_ads1x1x_set_input(adc_emul, 1, 3072000));
+
+	sample = adc_sample(&ch0_cfg);
+	zassert_equal(sample, 5333, "1 V of +/-6.144 V read as %d", sample);
+	sample = adc_sample(&ch1_cfg);
+	zassert_equal(sample, 16384, "3.072 V of +/-6.144 V read as %d", sample);
+	zassert_equal(tib_emul_ads1x1x_conversions(adc_emul) - conversions, 2);
+
+	zassert_equal(tib_emul_ads1x1x_set_input(adc_emul, 4, 0), -EINVAL);
+}
+
+ZTEST_SUITE(tib_emul, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file test the photodiode history ring
+ *
+ * The ring is never cleared, so each test first writes enough samples to
+ * replace everything earlier tests left in it.
+ */
+
+#include <zephyr/ztest.h>
+
+#include "history.h"
+
+/* @p n samples PUBLISH_INTERVAL_MS apart from @p t0, tagged v0, v0 + 1 ...,
+ * stepping through the six ranges
+ */
+static void fill(uint32_t t0, int n, int16_t v0)
+{
+	for (int i = 0; i < n; i++) {
+		int v = v0 + i;
+
+		history_add(t0 + i * PUBLISH_INTERVAL_MS, v, -v, v % 6, 5 - v % 6);
+	}
+}
+
+ZTEST(history, test_ring_wrap)
+{
+	static struct history_sample out[HISTORY_LEN];
+	uint32_t first, end, end0, seq;
+
+	history_range(&first, &end0);
+	fill(1000, HISTORY_LEN + 7, 0);
+	history_range(&first, &end);
+	zassert_equal(end - end0, HISTORY_LEN + 7);
+	zassert_equal(end - first, HISTORY_LEN, "ring holds %u", end - first);
+
+	/* The oldest 7 are gone; the rest come out in order */
+	seq = first;
+	zassert_equal(history_copy(&seq, end, out, ARRAY_SIZE(out)), HISTORY_LEN);
+	zassert_equal(seq, end);
+	for (int i = 0; i < HISTORY_LEN; i++) {
+		zassert_equal(out[i].yj, i + 7);
+		zassert_equal(out[i].hk, -(i + 7));
+		zassert_equal(out[i].yj_range, (i + 7) % 6);
+		zassert_equal(out[i].hk_range, 5 - (i + 7) % 6);
+		zassert_equal(out[i].t_ms, 1000U + (i + 7) * PUBLISH_INTERVAL_MS);
+	}
+}
+
+ZTEST(history, test_find_across_uptime_wrap)
+{
+	/* Sample 10 lands exactly on the wrap of the 32-bit uptime */
+	const uint32_t t0 = UINT32_MAX - 10 * PUBLISH_INTERVAL_MS + 1;
+	const uint32_t last = t0 + (HISTORY_LEN - 1) * PUBLISH_INTERVAL_MS;
+	uint32_t first, end;
+
+	fill(t0, HISTORY_LEN, 0);
+	history_range(&first, &end);
+	zassert_equal(end - first, HISTORY_LEN);
+
+	zassert_equal(history_find(t0 - 1000), first);
+	zassert_equal(history_find(t0), first);
+	zassert_equal(history_find(t0 + 1), first + 1);
+	zassert_equal(history_find(UINT32_MAX), first + 10);
+	zassert_equal(history_find(0), first + 10);
+	zassert_equal(history_find(1), first + 11);
+	zassert_equal(history_find(last), end - 1);
+	zassert_equal(history_find(last + 1), end);
+}
+
+ZTEST(history, test_copy_skips_overwritten)
+{
+	struct history_sample out[HISTORY_LEN];
+	uint32_t first, end, seq;
+
+	fill(5000, HISTORY_LEN, 0);
+	history_range(&first, &end);
+
+	/* A reader takes a first batch, then falls behind the writer */
+	seq = first;
+	zassert_equal(history_copy(&seq, end, out, 5), 5);
+	zassert_equal(seq, first + 5);
+	zassert_equal(out[4].yj, 4);
+
+	fill(5000 + HISTORY_LEN * PUBLISH_INTERVAL_MS, 20, HISTORY_LEN);
+	history_range(&first, &end);
+	zassert_equal(first, seq + 15);
+
+	/* It resumes at the oldest sample still held, end clipped to the head */
+	zassert_equal(history_copy(&seq, end + 100, out, ARRAY_SIZE(out)), HISTORY_LEN);
+	zassert_equal(seq, end);
+	zassert_equal(out[0].yj, 20);
+	zassert_equal(out[HISTORY_LEN - 1].yj, HISTORY_LEN + 19);
+
+	/* Nothing new */
+	zassert_equal(history_copy(&seq, end, out, ARRAY_SIZE(out)), 0);
+	zassert_equal(seq, end);
+}
+
+ZTEST_SUITE(history, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2025 Caltech Optical Observatories
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file test the attenuator calibration fit
+ *
+ * polyfit() is fed samples of known polynomials and must return their
+ * coefficients; degenerate input must be refused rather than solved.
+ */
+
+#include <zephyr/ztest.h>
+#include <errno.h>
+
+#include "polyfit.h"
+
+#define POINTS 12
+#define TOLERANCE 1e-6
+
+/* Sample the polynomial @p c at x = 0 .. 40 (the calibration's dB span) */
+static void sample(const double *c, int ncoeffs, double *x, double *y)
+{
+	for (int i = 0; i < POINTS; i++) {
+		double xr = 1.0;
+
+		x[i] = 40.0 * i / (POINTS - 1);
+		y[i] = 0.0;
+		for (int k = 0; k < ncoeffs; k++) {
+			y[i] += c[k] * xr;
+			xr *= x[i];
+		}
+	}
+}
+
+static void check_fit(const double *want, int ncoeffs)
+{
+	double x[POINTS], y[POINTS];
+	double got[POLYFIT_MAX_COEFFS];
+
+	sample(want, ncoeffs, x, y);
+	zassert_ok(polyfit(x, y, POINTS, ncoeffs, got));
+	for (int k = 0; k < ncoeffs; k++) {
+		zassert_within(got[k], want[k], TOLERANCE * MAX(1.0, fabs(want[k])),
+			       "order %d coefficient %d: %g, expected %g",
+			       ncoeffs - 1, k, got[k], want[k]);
+	}
+}
+
+ZTEST(polyfit, test_order_1)
+{
+	static const double c[] = { 3.3, -0.075 };
+
+	check_fit(c, ARRAY_SIZE(c));
+}
+
+ZTEST(polyfit, test_order_2)
+{
+	static const double c[] = { 0.12, 0.31, -0.004 };
+
+	check_fit(c, ARRAY_SIZE(c));
+}
+
+ZTEST(polyfit, test_order_4)
+{
+	static const double c[] = { 0.02, 0.85, -0.061, 2.1e-3, -2.4e-5 };
+
+	check_fit(c, ARRAY_SIZE(c));
+}
+
+/* Noise that averages out leaves a straight line unchanged */
+ZTEST(polyfit, test_least_squares)
+{
+	static const double x[] = { 0.0, 0.0, 1.0, 1.0, 2.0, 2.0 };
+	static const double y[] = { 0.9, 1.1, 2.9, 3.1, 4.9, 5.1 };
+	double c[2];
+
+	zassert_ok(polyfit(x, y, ARRAY_SIZE(x), ARRAY_SIZE(c), c));
+	zassert_within(c[0], 1.0, TOLERANCE);
+	zassert_within(c[1], 2.0, TOLERANCE);
+}
+
+ZTEST(polyfit, test_singular)
+{
+	static const double x[] = { 1.5, 1.5, 1.5, 1.5, 1.5, 1.5 };
+	static const double y[] = { 0.0, 1.0, 2.0, 3.0, 4.0, 5.0 };
+	double c[POLYFIT_MAX_COEFFS];
+
+	/* Every x equal: only the constant term is determined */
+	zassert_equal(polyfit(x, y, ARRAY_SIZE(x), 2, c), -ERANGE);
+	zassert_equal(polyfit(x, y, ARRAY_SIZE(x), 5, c), -ERANGE);
+
+	/* Fewer points than coefficients */
+	zassert_equal(polyfit(y, x, 2, 3, c), -ERANGE);
+
+	zassert_equal(polyfit(x, y, ARRAY_SIZE(x), 0, c), -EINVAL);
+	zassert_equal(polyfit(x, y, ARRAY_SIZE(x), POLYFIT_MAX_COEFFS + 1, c), -EINVAL);
+}
+
+ZTEST(polyfit, test_solve_pivot)
+{
+	/* Zero on the diagonal needs a row swap */
+	double m[] = { 0.0, 2.0, 3.0, 1.0 };
+	double b[] = { 4.0, 5.0 };
+	double singular[] = { 1.0, 2.0, 2.0, 4.0 };
+	double b2[] = { 1.0, 2.0 };
+
+	zassert_ok(polyfit_solve(m, b, 2));
+	zassert_within(b[0], 1.0, TOLERANCE);
+	zassert_within(b[1], 2.0, TOLERANCE);
+
+	zassert_equal(polyfit_solve(singular, b2, 2), -ERANGE);
+}
+
+ZTEST_SUITE(polyfit, NULL, NULL, NULL, NULL, NULL);